@@ -3,6 +3,8 @@
 
     public :
 
+    typedef T value_type;
+
     // IMPLEMENTATION LIBRARY
     const library lib;
 
@@ -30,12 +32,32 @@
     std::vector<int> ack_recver;
     void block_sender();
     void block_recver();
+    bool handshake = true;
+
+    // COPY ENGINE
+    int copythread = 1; // THREADS OF THE HOST COPIES (CPU IPC AND SELF), MORE IS OPT-IN, 0 FOR ALL ALLOWED CPUS
 
 
     // MPI
 #ifdef USE_MPI
     std::vector<MPI_Request> sendrequest;
     std::vector<MPI_Request> recvrequest;
+    std::vector<MPI_Request> windowrequest;
+    // PERSISTENT
+    std::vector<size_t> persist_sendcount;
+    std::vector<size_t> persist_recvcount;
+    std::vector<MPI_Request> persistrequest; // receives first, started at once
+    void persist();
+    std::vector<std::vector<MPI_Request>> persistwindow; // one more set for each call of a window but the last
+    std::vector<size_t> persistwindow_count; // counts of the sets, receives first
+    void persist(int window);
+    // ONE-SIDED
+    std::vector<MPI_Aint> remotedisp; // target address in the dynamic window
+    std::vector<std::pair<T*, size_t>> attached; // detached from the window at release()
+    MPI_Aint attach(T *buffer, size_t count) {
+      attached.push_back({buffer, count});
+      return rma_attach(buffer, count * sizeof(T));
+    }
 #endif
 
     // NCCL
@@ -54,7 +76,11 @@
     std::vector<hipStream_t> stream_ipc;
 #elif defined PORT_ONEAPI
     std::vector<sycl::queue> q_ipc;
+#else
+    std::vector<pid_t> pid_ipc; // PROCESS OF THE REMOTE BUFFER
+    void ipc_copy(pid_t pid, char *local, char *remote, size_t bytes, bool put);
 #endif
+    bool shared_exchange(T *&buffer, size_t &offset, int proc, bool owner);
     // IPC ZE
 #ifdef IPC_ze
     std::vector<ze_command_list_handle_t> command_list;
@@ -74,6 +100,7 @@
       return -1;
     }
     std::vector<gex_Event_t> gex_event;
+    std::vector<gex_Event_t> gex_event_window;
     std::vector<int> remote_sendind;
     std::vector<int> remote_recvind;
     bool send_ready() {
@@ -94,21 +121,88 @@
     static void am_notify_recver(gex_Token_t token, gex_AM_Arg_t recv, gex_AM_Arg_t bench) { ((Comm<T>*)benchlist[bench])->ack_recver[recv] = 1; };
 #endif
 
+    // IPC HANDLE
+#ifdef PORT_CUDA
+    typedef cudaIpcMemHandle_t ipchandle_t;
+#elif defined PORT_HIP
+    typedef hipIpcMemHandle_t ipchandle_t;
+#elif defined PORT_ONEAPI
+    typedef struct { int fd; pid_t pid; } ipchandle_t;
+#else
+    typedef struct { pid_t pid; T *ptr; uint64_t node; } ipchandle_t;
+#endif
+    void ipc_gethandle(T *buffer, ipchandle_t &handle);
+    void ipc_openhandle(ipchandle_t &handle, T *&remote);
+#ifdef IPC_ze
+    int ipc_queue(int sendid, int recvid);
+#endif
+
+    // LOCAL REGISTRY (COMMITTED COLLECTIVELY)
+    struct record_t {
+      T *buf;
+      size_t offset;
+      size_t count;
+      int proc;
+      int index;
+      int ep;
+      ipchandle_t handle;
+#ifdef USE_MPI
+      MPI_Aint disp;
+#endif
+    };
+    std::vector<record_t> pending_send;
+    std::vector<record_t> pending_recv;
+
     Comm(library lib);
     void free();
+    void release();
     void init();
 
     void add(T *sendbuf, size_t sendoffset, T *recvbuf, size_t recvoffset, size_t count, int sendid, int recvid);
     void add(T *sendbuf, T *recvbuf, size_t count, int sendid, int recvid);
     void add(size_t count, int sendid, int recvid);
+    size_t maxcount(size_t count);
+    void add_send(T *sendbuf, size_t sendoffset, size_t count, int recvid);
+    void add_recv(T *recvbuf, size_t recvoffset, size_t count, int sendid);
+    void commit();
+    void add(pattern_t &pattern, T *sendbuf, T *recvbuf);
     void pyadd(pyalloc<T> sendbuf, size_t sendoffset, pyalloc<T> recvbuf, size_t recvoffset, size_t count, int sendid, int recvid);
     void start();
     void wait();
+    void start(int window);
+    void wait(int window);
 
     void measure(int warmup, int numiter);
     void measure(int warmup, int numiter, size_t data);
+    void measure_adaptive(double precision, double budget);
+    template <typename C>
+    void measure_cold(int warmup, int numiter, size_t count, histogram_t &hot, C &comm);
+    struct sweep_t {
+      size_t count;
+      double minTime;
+      double medTime;
+      double p99Time;
+      double maxTime;
+      double avgTime;
+    };
+    std::vector<sweep_t> measure_sweep(int warmup, int numiter, int numstep);
+    void measure_window(int warmup, int numiter, int window, size_t count);
+    void measure_pingpong(int warmup, int numiter, int window);
+    void measure_overlap(int warmup, int numiter, double fraction);
+    void measure_copy(int warmup, int numiter);
+    void fit(model_t &model, int warmup, int numiter, int numstep);
+    double predict(model_t &model);
+    void record(const char *mode, size_t count, histogram_t &hist, const std::vector<double> &iters);
+    struct nonzero_t {
+      int sendid;
+      int recvid;
+      size_t numcomm;
+      size_t count;
+    };
+    std::vector<nonzero_t> getSparse();
     std::vector<size_t> getMatrix();
     void report();
+    void report(const char *filename);
 
     // void allocate(T *&buffer, size_t n);
     // void allocate(T *&buffer, size_t n, int i);
@@ -197,7 +291,16 @@
       }
 #endif
     }
+#ifdef USE_MPI
+    if(lib == MPI_put || lib == MPI_get)
+      rma_window();
+#endif
     if(lib == IPC || lib == IPC_get) {
+#if !defined PORT_CUDA && !defined PORT_HIP && !defined PORT_ONEAPI && defined PR_SET_PTRACER
+      // CROSS MEMORY ATTACH NEEDS PTRACE ACCESS, WHICH YAMA RESTRICTS TO ANCESTORS BY DEFAULT (OPT-IN)
+      if(ipc_ptracer)
+        prctl(PR_SET_PTRACER, PR_SET_PTRACER_ANY, 0, 0, 0);
+#endif
 #ifdef IPC_ze
       ze_context_handle_t hContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_context());
       ze_device_handle_t hDevice = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_device());
@@ -318,10 +421,14 @@
   void Comm<T>::add(size_t count, int sendid, int recvid) {
     T *sendbuf;
     T *recvbuf;
+    // ONLY THE PAIR ALLOCATES, WHICH CANNOT TAKE PART IN THE NODE-WIDE COLLECTIVE OF sharedmemory: PLAIN HOST MEMORY IS USED INSTEAD
+    bool sharedmemory_temp = sharedmemory;
+    sharedmemory = false;
     if (myid == sendid)
       allocate(sendbuf, count);
     if (myid == recvid)
       allocate(recvbuf, count);
+    sharedmemory = sharedmemory_temp;
     add(sendbuf, 0, recvbuf, 0, count, sendid, recvid);
   }
   template <typename T>
@@ -338,12 +445,7 @@
     }
     // ADJUST MESSAGE SIZE
     {
-// #define COMMBENCH_MESSAGE 16777216 // 16 MB message size if desired
-#ifdef COMMBENCH_MESSAGE
-      size_t max = COMMBENCH_MESSAGE / sizeof(T);
-#else
-      size_t max = (lib == MPI ? 2e9 / sizeof(T) : count);
-#endif
+      size_t max = maxcount(count);
       while(count > max) {
         add(sendbuf, sendoffset, recvbuf, recvoffset, max, sendid, recvid);
         count = count - max;
@@ -426,6 +528,26 @@
         case MPI:
           sendrequest.push_back(MPI_Request());
           break;
+        case MPI_persist:
+          sendrequest.push_back(MPI_REQUEST_NULL);
+          break;
+        case MPI_put:
+          ack_sender.push_back(int());
+          remotedisp.push_back(MPI_Aint());
+          // RECEIVE REMOTE ADDRESS
+          if(sendid != recvid)
+            recv(&remotedisp[numsend], recvid);
+          else
+            remotedisp[numsend] = attach(recvbuf + recvoffset, count);
+          break;
+        case MPI_get:
+          ack_sender.push_back(int());
+          // SEND REMOTE ADDRESS
+          if(sendid != recvid) {
+            MPI_Aint disp = attach(sendbuf + sendoffset, count);
+            send(&disp, recvid);
+          }
+          break;
 #endif
         case NCCL:
           break;
@@ -442,9 +564,11 @@
           hipStreamCreate(&stream_ipc[numsend]);
 #elif defined PORT_ONEAPI
           q_ipc.push_back(sycl::queue(sycl::gpu_selector_v));
+#else
+          pid_ipc.push_back(getpid());
 #endif
-          // RECIEVE REMOTE MEMORY HANDLE
-          if(sendid != recvid) {
+          // RECIEVE REMOTE MEMORY HANDLE UNLESS THE BUFFER IS MAPPED IN NODE-WIDE SHARED MEMORY
+          if(sendid != recvid && !(sharedmemory && shared_exchange(remotebuf[numsend], remoteoffset[numsend], recvid, false))) {
             int error = -1;
 #ifdef PORT_CUDA
             cudaIpcMemHandle_t memhandle;
@@ -469,6 +593,12 @@
 	    auto zeContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_context());
 	    auto zeDevice = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_device());
 	    error = zeMemOpenIpcHandle(zeContext, zeDevice, memhandle, 0, (void**)&remotebuf[numsend]);
+#else
+            ipchandle_t memhandle;
+            recv(&memhandle, recvid);
+            ipc_openhandle(memhandle, remotebuf[numsend]);
+            pid_ipc[numsend] = memhandle.pid;
+            error = 0;
 #endif
             if(error)
               printf("IpcOpenMemHandle error %d\n", error);
@@ -480,8 +610,8 @@
           break;
         case IPC_get:
           ack_sender.push_back(int());
-          // SEND REMOTE MEMORY HANDLE
-          if(sendid != recvid)
+          // SEND REMOTE MEMORY HANDLE UNLESS THE RECEIVER MAPS THE BUFFER IN NODE-WIDE SHARED MEMORY
+          if(sendid != recvid && !(sharedmemory && shared_exchange(sendbuf, sendoffset, recvid, true)))
           {
             int error = -1;
 #ifdef PORT_CUDA
@@ -504,6 +634,11 @@
               send(&what_intel_should_have_done, recvid);
             }
             // send(&memhandle, sendid);
+#else
+            ipchandle_t memhandle;
+            ipc_gethandle(sendbuf, memhandle);
+            send(&memhandle, recvid);
+            error = 0;
 #endif
             if(error)
               printf("IpcGetMemHandle error %d\n", error);
@@ -563,13 +698,33 @@
         case MPI:
           recvrequest.push_back(MPI_Request());
           break;
+        case MPI_persist:
+          recvrequest.push_back(MPI_REQUEST_NULL);
+          break;
+        case MPI_put:
+          ack_recver.push_back(int());
+          // SEND REMOTE ADDRESS
+          if(sendid != recvid) {
+            MPI_Aint disp = attach(recvbuf + recvoffset, count);
+            send(&disp, sendid);
+          }
+          break;
+        case MPI_get:
+          ack_recver.push_back(int());
+          remotedisp.push_back(MPI_Aint());
+          // RECEIVE REMOTE ADDRESS
+          if(sendid != recvid)
+            recv(&remotedisp[numrecv], sendid);
+          else
+            remotedisp[numrecv] = attach(sendbuf + sendoffset, count);
+          break;
 #endif
         case NCCL:
           break;
         case IPC:
           ack_recver.push_back(int());
-          // SEND REMOTE MEMORY HANDLE
-          if(sendid != recvid)
+          // SEND REMOTE MEMORY HANDLE UNLESS THE SENDER MAPS THE BUFFER IN NODE-WIDE SHARED MEMORY
+          if(sendid != recvid && !(sharedmemory && shared_exchange(recvbuf, recvoffset, sendid, true)))
           {
             int error = -1;
 #ifdef PORT_CUDA
@@ -592,6 +747,11 @@
               send(&what_intel_should_have_done, sendid);
             }
             // send(&memhandle, sendid);
+#else
+            ipchandle_t memhandle;
+            ipc_gethandle(recvbuf, memhandle);
+            send(&memhandle, sendid);
+            error = 0;
 #endif
             if(error)
               printf("IpcGetMemHandle error %d\n", error);
@@ -611,9 +771,11 @@
           hipStreamCreate(&stream_ipc[numrecv]);
 #elif defined PORT_ONEAPI
           q_ipc.push_back(sycl::queue(sycl::gpu_selector_v));
+#else
+          pid_ipc.push_back(getpid());
 #endif
-          // RECV REMOTE MEMORY HANDLE
-          if(sendid != recvid) {
+          // RECV REMOTE MEMORY HANDLE UNLESS THE BUFFER IS MAPPED IN NODE-WIDE SHARED MEMORY
+          if(sendid != recvid && !(sharedmemory && shared_exchange(remotebuf[numrecv], remoteoffset[numrecv], sendid, false))) {
             int error = -1;
 #ifdef PORT_CUDA
             cudaIpcMemHandle_t memhandle;
@@ -638,6 +800,12 @@
             auto zeContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_context());
             auto zeDevice = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_device());
             error = zeMemOpenIpcHandle(zeContext, zeDevice, memhandle, 0, (void**)&remotebuf[numrecv]);
+#else
+            ipchandle_t memhandle;
+            recv(&memhandle, sendid);
+            ipc_openhandle(memhandle, remotebuf[numrecv]);
+            pid_ipc[numrecv] = memhandle.pid;
+            error = 0;
 #endif
             if(error)
               printf("IpcOpenMemHandle error %d\n", error);
@@ -682,6 +850,571 @@
       } // switch(lib)
       numrecv++;
     }
+#ifdef USE_MPI
+    if(lib == MPI_persist)
+      persist();
+#endif
+  }
+
+  template <typename T>
+  size_t Comm<T>::maxcount(size_t count) {
+// #define COMMBENCH_MESSAGE 16777216 // 16 MB message size if desired
+#ifdef COMMBENCH_MESSAGE
+    return COMMBENCH_MESSAGE / sizeof(T);
+#else
+#if defined USE_MPI && MPI_VERSION >= 4
+    if(lib == MPI_persist)
+      return count; // LARGE-COUNT VARIANTS
+#endif
+    return (lib == MPI || lib == MPI_persist || lib == MPI_put || lib == MPI_get ? 2e9 / sizeof(T) : count);
+#endif
+  }
+
+#ifdef USE_MPI
+  // PERSISTENT REQUESTS ARE CREATED AT REGISTRATION AND RECREATED ONLY FOR THE MESSAGES WHOSE COUNTS HAVE CHANGED (E.G., IN A SWEEP)
+  template <typename T>
+  void Comm<T>::persist() {
+    bool changed = false;
+    persist_sendcount.resize(numsend, -1);
+    persist_recvcount.resize(numrecv, -1);
+    for(int send = 0; send < numsend; send++)
+      if(persist_sendcount[send] != sendcount[send]) {
+        if(sendrequest[send] != MPI_REQUEST_NULL)
+          MPI_Request_free(&sendrequest[send]);
+#if MPI_VERSION >= 4
+        MPI_Send_init_c(sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T), MPI_BYTE, sendproc[send], 0, comm_mpi, &sendrequest[send]);
+#else
+        MPI_Send_init(sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T), MPI_BYTE, sendproc[send], 0, comm_mpi, &sendrequest[send]);
+#endif
+        persist_sendcount[send] = sendcount[send];
+        changed = true;
+      }
+    for(int recv = 0; recv < numrecv; recv++)
+      if(persist_recvcount[recv] != recvcount[recv]) {
+        if(recvrequest[recv] != MPI_REQUEST_NULL)
+          MPI_Request_free(&recvrequest[recv]);
+#if MPI_VERSION >= 4
+        MPI_Recv_init_c(recvbuf[recv] + recvoffset[recv], recvcount[recv] * sizeof(T), MPI_BYTE, recvproc[recv], 0, comm_mpi, &recvrequest[recv]);
+#else
+        MPI_Recv_init(recvbuf[recv] + recvoffset[recv], recvcount[recv] * sizeof(T), MPI_BYTE, recvproc[recv], 0, comm_mpi, &recvrequest[recv]);
+#endif
+        persist_recvcount[recv] = recvcount[recv];
+        changed = true;
+      }
+    if(changed) {
+      persistrequest = recvrequest;
+      persistrequest.insert(persistrequest.end(), sendrequest.begin(), sendrequest.end());
+    }
+  }
+  // A PERSISTENT REQUEST CANNOT BE RESTARTED BEFORE IT COMPLETES: A WINDOW STARTS window - 1 ADDITIONAL SETS BEFORE THE MAIN SET
+  // THE SETS ARE KEPT ACROSS WINDOWS AND RECREATED WHEN THE COUNTS CHANGE
+  template <typename T>
+  void Comm<T>::persist(int window) {
+    persist();
+    std::vector<size_t> count(recvcount.begin(), recvcount.begin() + numrecv);
+    count.insert(count.end(), sendcount.begin(), sendcount.begin() + numsend);
+    if(count != persistwindow_count) {
+      for(std::vector<MPI_Request> &set : persistwindow)
+        for(MPI_Request &request : set)
+          MPI_Request_free(&request);
+      persistwindow.clear();
+      persistwindow_count = count;
+    }
+    while((int)persistwindow.size() < window - 1) {
+      std::vector<MPI_Request> set(numrecv + numsend);
+      for(int recv = 0; recv < numrecv; recv++)
+#if MPI_VERSION >= 4
+        MPI_Recv_init_c(recvbuf[recv] + recvoffset[recv], recvcount[recv] * sizeof(T), MPI_BYTE, recvproc[recv], 0, comm_mpi, &set[recv]);
+#else
+        MPI_Recv_init(recvbuf[recv] + recvoffset[recv], recvcount[recv] * sizeof(T), MPI_BYTE, recvproc[recv], 0, comm_mpi, &set[recv]);
+#endif
+      for(int send = 0; send < numsend; send++)
+#if MPI_VERSION >= 4
+        MPI_Send_init_c(sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T), MPI_BYTE, sendproc[send], 0, comm_mpi, &set[numrecv + send]);
+#else
+        MPI_Send_init(sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T), MPI_BYTE, sendproc[send], 0, comm_mpi, &set[numrecv + send]);
+#endif
+      persistwindow.push_back(set);
+    }
+  }
+#endif
+
+  // NODE-WIDE SHARED MEMORY IN add(): THE OWNER OF THE BUFFER SENDS ITS ADDRESS AND OFFSET, THE PEER RESOLVES THE ADDRESS IN THE SHARED SEGMENTS
+  // AND RETURNS WHETHER IT MAPS THE BUFFER, SO THAT BOTH SIDES EITHER SKIP OR EXCHANGE THE IPC HANDLE
+  template <typename T>
+  bool Comm<T>::shared_exchange(T *&buffer, size_t &offset, int proc, bool owner) {
+    struct {
+      T *buffer;
+      size_t offset;
+    } where = {buffer, offset};
+    char shared = 0;
+    if(owner) {
+      send(&where, proc);
+      recv(&shared, proc);
+    }
+    else {
+      recv(&where, proc);
+      T *view = (T*)shared_translate(where.buffer, proc);
+      shared = (view != nullptr);
+      send(&shared, proc);
+      if(shared) {
+        buffer = view;
+        offset = where.offset;
+      }
+    }
+    return shared;
+  }
+
+  // RELEASE THE LIBRARY RESOURCES OF A TEMPORARY COMMUNICATOR AND REMOVE IT FROM THE BENCH LIST, THE BUFFERS ARE NOT FREED
+  // ITS BUFFERS ARE DETACHED FROM THE DYNAMIC WINDOW, SO THE OTHER PROCESSES MUST BE DONE WITH THEM (AFTER wait())
+  template <typename T>
+  void Comm<T>::release() {
+#ifdef USE_MPI
+    if(lib == MPI_persist) {
+      for(MPI_Request &request : persistrequest)
+        if(request != MPI_REQUEST_NULL)
+          MPI_Request_free(&request);
+      for(std::vector<MPI_Request> &set : persistwindow)
+        for(MPI_Request &request : set)
+          MPI_Request_free(&request);
+      persistrequest.clear();
+      persistwindow.clear();
+      sendrequest.assign(numsend, MPI_REQUEST_NULL);
+      recvrequest.assign(numrecv, MPI_REQUEST_NULL);
+    }
+    for(std::pair<T*, size_t> &buffer : attached)
+      rma_detach(buffer.first, buffer.second * sizeof(T));
+    attached.clear();
+#endif
+    if(lib == NCCL) {
+#if defined CAP_NCCL && defined PORT_CUDA
+      cudaStreamDestroy(stream_nccl);
+#elif defined CAP_NCCL && defined PORT_HIP
+      hipStreamDestroy(stream_nccl);
+#elif defined CAP_ONECCL
+      delete stream_ccl;
+#endif
+    }
+#ifdef PORT_CUDA
+    for(cudaStream_t &stream : stream_ipc)
+      cudaStreamDestroy(stream);
+    stream_ipc.clear();
+#elif defined PORT_HIP
+    for(hipStream_t &stream : stream_ipc)
+      hipStreamDestroy(stream);
+    stream_ipc.clear();
+#elif defined PORT_ONEAPI
+    q_ipc.clear();
+#endif
+    if(benchid < (int)benchlist.size())
+      benchlist[benchid] = nullptr;
+  }
+
+  template <typename T>
+  void Comm<T>::ipc_gethandle(T *buffer, ipchandle_t &handle) {
+    int error = -1;
+#ifdef PORT_CUDA
+    error = cudaIpcGetMemHandle(&handle, buffer);
+#elif defined PORT_HIP
+    error = hipIpcGetMemHandle(&handle, buffer);
+#elif defined PORT_ONEAPI
+    ze_ipc_mem_handle_t memhandle;
+    auto zeContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_context());
+    error = zeMemGetIpcHandle(zeContext, buffer, &memhandle);
+    memcpy((void *)&handle.fd, (void *)&memhandle, sizeof(int));
+    handle.pid = getpid();
+#else
+    handle.pid = getpid();
+    handle.ptr = buffer;
+    handle.node = node_identity();
+    error = 0;
+#endif
+    if(error)
+      printf("IpcGetMemHandle error %d\n", error);
+  }
+
+  template <typename T>
+  void Comm<T>::ipc_openhandle(ipchandle_t &handle, T *&remote) {
+    int error = -1;
+#ifdef PORT_CUDA
+    error = cudaIpcOpenMemHandle((void**)&remote, handle, cudaIpcMemLazyEnablePeerAccess);
+#elif defined PORT_HIP
+    error = hipIpcOpenMemHandle((void**)&remote, handle, hipIpcMemLazyEnablePeerAccess);
+#elif defined PORT_ONEAPI
+    ze_ipc_mem_handle_t memhandle;
+    int pidfd = syscall(SYS_pidfd_open, handle.pid, 0);
+    int myfd = syscall(438, pidfd, handle.fd, 0); // SYS_pidfd_getfd
+    memcpy((void *)&memhandle, (void *)&myfd, sizeof(int));
+    auto zeContext = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_context());
+    auto zeDevice = sycl::get_native<sycl::backend::ext_oneapi_level_zero>(q.get_device());
+    error = zeMemOpenIpcHandle(zeContext, zeDevice, memhandle, 0, (void**)&remote);
+#else
+    // ADDRESS IN THE REMOTE PROCESS, COPIED WITH ipc_copy
+    if(handle.node == node_identity()) {
+      remote = handle.ptr;
+      error = 0;
+    }
+    else {
+      printf("proc %d IPC handle of pid %d is from another node, CPU IPC is refused, use MPI across nodes\n", myid, (int)handle.pid);
+      remote = nullptr;
+      handle.pid = -1; // ipc_copy SKIPS REFUSED PAIRS
+      error = 0;
+    }
+#endif
+    if(error)
+      printf("IpcOpenMemHandle error %d\n", error);
+  }
+
+#if !defined PORT_CUDA && !defined PORT_HIP && !defined PORT_ONEAPI
+  // CROSS MEMORY ATTACH: SINGLE COPY BETWEEN THE ADDRESS SPACES OF TWO PROCESSES, CHUNKS ARE SPREAD OVER THE COPY ENGINE
+  template <typename T>
+  void Comm<T>::ipc_copy(pid_t pid, char *local, char *remote, size_t bytes, bool put) {
+    if(pid < 0)
+      return; // REFUSED AT REGISTRATION
+    int numthread = copythread ? copythread : copy_engine.maxthread();
+    if(pid == getpid()) {
+      if(put)
+        copy_engine.copy(numthread, remote, local, bytes);
+      else
+        copy_engine.copy(numthread, local, remote, bytes);
+      return;
+    }
+    std::atomic<int> error(0);
+    copy_engine.run(numthread, bytes, local, [&](size_t begin, size_t end) {
+      // A CALL MAY TRANSFER PARTIALLY
+      while(begin < end) {
+        struct iovec local_iov = {local + begin, end - begin};
+        struct iovec remote_iov = {remote + begin, end - begin};
+        ssize_t done = put ? process_vm_writev(pid, &local_iov, 1, &remote_iov, 1, 0) : process_vm_readv(pid, &local_iov, 1, &remote_iov, 1, 0);
+        if(done <= 0) {
+          error = errno;
+          break;
+        }
+        begin += done;
+      }
+    });
+    if(error)
+      printf("process_vm_%s error: %s%s\n", put ? "writev" : "readv", strerror(error.load()), error == EPERM && !ipc_ptracer ? " (set CommBench::ipc_ptracer = true if Yama restricts ptrace)" : "");
+  }
+#endif
+
+#ifdef IPC_ze
+  template <typename T>
+  int Comm<T>::ipc_queue(int sendid, int recvid) {
+    // queue selection for copy engines
+    if(sendid / 2 == recvid / 2)
+      return (sendid == recvid ? 0 : 1); // self or across tiles in the same device
+    // tiles across devices
+    int queue = 2 + (ordinal2index % 7); // roundrobin: 2, 3, 4, 5, 6, 7, 8, 2, 3, ...
+    ordinal2index++;
+    return queue;
+  }
+#endif
+
+  template <typename T>
+  void Comm<T>::add_send(T *sendbuf, size_t sendoffset, size_t count, int recvid) {
+    // OMIT ZERO MESSAGE SIZE
+    if(count == 0)
+      return;
+    // ADJUST MESSAGE SIZE
+    size_t max = maxcount(count);
+    while(count > max) {
+      add_send(sendbuf, sendoffset, max, recvid);
+      count = count - max;
+      sendoffset += max;
+    }
+    record_t record = {};
+    record.buf = sendbuf;
+    record.offset = sendoffset;
+    record.count = count;
+    record.proc = recvid;
+    pending_send.push_back(record);
+  }
+
+  template <typename T>
+  void Comm<T>::add_recv(T *recvbuf, size_t recvoffset, size_t count, int sendid) {
+    // OMIT ZERO MESSAGE SIZE
+    if(count == 0)
+      return;
+    // ADJUST MESSAGE SIZE
+    size_t max = maxcount(count);
+    while(count > max) {
+      add_recv(recvbuf, recvoffset, max, sendid);
+      count = count - max;
+      recvoffset += max;
+    }
+    record_t record = {};
+    record.buf = recvbuf;
+    record.offset = recvoffset;
+    record.count = count;
+    record.proc = sendid;
+    pending_recv.push_back(record);
+  }
+
+  template <typename T>
+  void Comm<T>::commit() {
+
+    // SORT LOCAL REGISTRY BY PEER (PRESERVES MATCHING ORDER WITHIN PEER)
+    auto by_proc = [](const record_t &a, const record_t &b) -> bool {return a.proc < b.proc;};
+    std::stable_sort(pending_send.begin(), pending_send.end(), by_proc);
+    std::stable_sort(pending_recv.begin(), pending_recv.end(), by_proc);
+
+    // EXCHANGE MESSAGE COUNTS
+    std::vector<size_t> sendcount_proc(numproc, 0);
+    std::vector<size_t> recvcount_proc(numproc, 0);
+    for(record_t &record : pending_send)
+      sendcount_proc[record.proc]++;
+    for(record_t &record : pending_recv)
+      recvcount_proc[record.proc]++;
+    std::vector<std::vector<size_t>> count_out(numproc);
+    std::vector<std::vector<size_t>> count_in;
+    for(int p = 0; p < numproc; p++)
+      count_out[p] = {sendcount_proc[p], recvcount_proc[p]};
+    alltoallv(count_out, count_in);
+
+    // VALIDATE MATCHING
+    std::vector<bool> match(numproc);
+    for(int p = 0; p < numproc; p++) {
+      match[p] = (count_in[p][0] == recvcount_proc[p]) && (count_in[p][1] == sendcount_proc[p]);
+      if(!match[p])
+        printf("Bench %d commit proc %d registers %zu sends %zu recvs with proc %d, which registers %zu recvs %zu sends (skipped)\n", benchid, myid, sendcount_proc[p], recvcount_proc[p], p, count_in[p][1], count_in[p][0]);
+    }
+    auto unmatched = [&match](const record_t &record) -> bool {return !match[record.proc];};
+    pending_send.erase(std::remove_if(pending_send.begin(), pending_send.end(), unmatched), pending_send.end());
+    pending_recv.erase(std::remove_if(pending_recv.begin(), pending_recv.end(), unmatched), pending_recv.end());
+
+    // EXCHANGE METADATA OF LOCAL BUFFERS
+    std::vector<std::vector<record_t>> outbox(numproc);
+    std::vector<std::vector<record_t>> inbox;
+    for(size_t send = 0; send < pending_send.size(); send++) {
+      record_t &record = pending_send[send];
+      record.index = numsend + send;
+#ifdef CAP_GASNET
+      record.ep = find_ep(record.buf);
+#endif
+      if(lib == IPC_get && record.proc != myid)
+        ipc_gethandle(record.buf, record.handle);
+#ifdef USE_MPI
+      if(lib == MPI_get)
+        record.disp = attach(record.buf + record.offset, record.count);
+#endif
+      outbox[record.proc].push_back(record);
+    }
+    for(size_t recv = 0; recv < pending_recv.size(); recv++) {
+      record_t &record = pending_recv[recv];
+      record.index = numrecv + recv;
+#ifdef CAP_GASNET
+      record.ep = find_ep(record.buf);
+#endif
+      if(lib == IPC && record.proc != myid)
+        ipc_gethandle(record.buf, record.handle);
+#ifdef USE_MPI
+      if(lib == MPI_put)
+        record.disp = attach(record.buf + record.offset, record.count);
+#endif
+      outbox[record.proc].push_back(record);
+    }
+    alltoallv(outbox, inbox);
+
+    // SENDER DATA STRUCTURES
+    {
+      std::vector<size_t> next(numproc, 0);
+      for(record_t &record : pending_send) {
+        int recvid = record.proc;
+        // REMOTE RECEIVE IS AFTER THE REMOTE SENDS
+        record_t &remote = inbox[recvid][recvcount_proc[recvid] + next[recvid]++];
+        // EXTEND REGISTRY
+        sendbuf.push_back(record.buf);
+        sendproc.push_back(recvid);
+        sendcount.push_back(record.count);
+        sendoffset.push_back(record.offset);
+        // SETUP CAPABILITY
+        switch(lib) {
+#ifdef USE_MPI
+          case MPI:
+            sendrequest.push_back(MPI_Request());
+            break;
+          case MPI_persist:
+            sendrequest.push_back(MPI_REQUEST_NULL);
+            break;
+          case MPI_put:
+            ack_sender.push_back(int());
+            remotedisp.push_back(remote.disp);
+            break;
+          case MPI_get:
+            ack_sender.push_back(int());
+            break;
+#endif
+          case IPC:
+            ack_sender.push_back(int());
+            remotebuf.push_back(remote.buf);
+            remoteoffset.push_back(remote.offset);
+#ifdef PORT_CUDA
+            stream_ipc.push_back(cudaStream_t());
+            cudaStreamCreate(&stream_ipc[numsend]);
+#elif defined PORT_HIP
+            stream_ipc.push_back(hipStream_t());
+            hipStreamCreate(&stream_ipc[numsend]);
+#elif defined PORT_ONEAPI
+            q_ipc.push_back(sycl::queue(sycl::gpu_selector_v));
+#else
+            pid_ipc.push_back(getpid());
+#endif
+            if(recvid != myid && shared_translate(remote.buf, recvid))
+              remotebuf[numsend] = (T*)shared_translate(remote.buf, recvid); // NODE-WIDE SHARED MEMORY
+            else if(recvid != myid) {
+              ipc_openhandle(remote.handle, remotebuf[numsend]);
+#if !defined PORT_CUDA && !defined PORT_HIP && !defined PORT_ONEAPI
+              pid_ipc[numsend] = remote.handle.pid;
+#endif
+            }
+#ifdef IPC_ze
+            zeCommandListAppendMemoryCopy(command_list[ipc_queue(myid, recvid)], remotebuf[numsend] + remoteoffset[numsend], sendbuf[numsend] + sendoffset[numsend], sendcount[numsend], nullptr, 0, nullptr);
+#endif
+            break;
+          case IPC_get:
+            ack_sender.push_back(int());
+            break;
+#ifdef CAP_GASNET
+          case GEX:
+            my_ep.push_back(record.ep);
+            remote_ep.push_back(remote.ep);
+            gex_event.push_back(gex_Event_t());
+            ack_sender.push_back(int(0));
+            remotebuf.push_back(remote.buf);
+            remoteoffset.push_back(remote.offset);
+            remote_recvind.push_back(remote.index);
+            break;
+          case GEX_get:
+            ack_sender.push_back(int(0));
+            remote_recvind.push_back(remote.index);
+            break;
+#endif
+          default:
+            break;
+        }
+        numsend++;
+      }
+    }
+
+    // RECEIVER DATA STRUCTURES
+    {
+      std::vector<size_t> next(numproc, 0);
+      for(record_t &record : pending_recv) {
+        int sendid = record.proc;
+        record_t &remote = inbox[sendid][next[sendid]++];
+        // EXTEND REGISTRY
+        recvbuf.push_back(record.buf);
+        recvproc.push_back(sendid);
+        recvcount.push_back(record.count);
+        recvoffset.push_back(record.offset);
+        // SETUP LIBRARY
+        switch(lib) {
+#ifdef USE_MPI
+          case MPI:
+            recvrequest.push_back(MPI_Request());
+            break;
+          case MPI_persist:
+            recvrequest.push_back(MPI_REQUEST_NULL);
+            break;
+          case MPI_put:
+            ack_recver.push_back(int());
+            break;
+          case MPI_get:
+            ack_recver.push_back(int());
+            remotedisp.push_back(remote.disp);
+            break;
+#endif
+          case IPC:
+            ack_recver.push_back(int());
+            break;
+          case IPC_get:
+            ack_recver.push_back(int());
+            remotebuf.push_back(remote.buf);
+            remoteoffset.push_back(remote.offset);
+#ifdef PORT_CUDA
+            stream_ipc.push_back(cudaStream_t());
+            cudaStreamCreate(&stream_ipc[numrecv]);
+#elif defined PORT_HIP
+            stream_ipc.push_back(hipStream_t());
+            hipStreamCreate(&stream_ipc[numrecv]);
+#elif defined PORT_ONEAPI
+            q_ipc.push_back(sycl::queue(sycl::gpu_selector_v));
+#else
+            pid_ipc.push_back(getpid());
+#endif
+            if(sendid != myid && shared_translate(remote.buf, sendid))
+              remotebuf[numrecv] = (T*)shared_translate(remote.buf, sendid); // NODE-WIDE SHARED MEMORY
+            else if(sendid != myid) {
+              ipc_openhandle(remote.handle, remotebuf[numrecv]);
+#if !defined PORT_CUDA && !defined PORT_HIP && !defined PORT_ONEAPI
+              pid_ipc[numrecv] = remote.handle.pid;
+#endif
+            }
+#ifdef IPC_ze
+            zeCommandListAppendMemoryCopy(command_list[ipc_queue(sendid, myid)], recvbuf[numrecv] + recvoffset[numrecv], remotebuf[numrecv] + remoteoffset[numrecv], recvcount[numrecv], nullptr, 0, nullptr);
+#endif
+            break;
+#ifdef CAP_GASNET
+          case GEX:
+            ack_recver.push_back(int(0));
+            remote_sendind.push_back(remote.index);
+            break;
+          case GEX_get:
+            my_ep.push_back(record.ep);
+            remote_ep.push_back(remote.ep);
+            gex_event.push_back(gex_Event_t());
+            ack_recver.push_back(int(0));
+            remotebuf.push_back(remote.buf);
+            remoteoffset.push_back(remote.offset);
+            remote_sendind.push_back(remote.index);
+            break;
+#endif
+          default:
+            break;
+        }
+        numrecv++;
+      }
+    }
+
+#ifdef USE_MPI
+    if(lib == MPI_persist)
+      persist();
+#endif
+
+    // REPORT
+    long numcommit = pending_send.size();
+    long countcommit = 0;
+    for(record_t &record : pending_send)
+      countcommit += record.count;
+    allreduce_sum(&numcommit);
+    allreduce_sum(&countcommit);
+    numcomm += numcommit;
+    if(myid == printid) {
+      printf("Bench %d commit %ld communications count %ld (", benchid, numcommit, countcommit);
+      print_data(countcommit * sizeof(T));
+      printf(") ");
+      print_lib(lib);
+      printf("\n");
+    }
+    pending_send.clear();
+    pending_recv.clear();
+  }
+
+  // REGISTER A LOADED PATTERN: SENDS ARE PACKED IN RECEIVER ORDER, RECEIVES ARE PACKED IN SENDER ORDER
+  template <typename T>
+  void Comm<T>::add(pattern_t &pattern, T *sendbuf, T *recvbuf) {
+    size_t sendoffset = 0;
+    for(size_t i = 0; i < pattern.sendproc.size(); i++) {
+      add_send(sendbuf, sendoffset, pattern.sendcount[i], pattern.sendproc[i]);
+      sendoffset += pattern.sendcount[i];
+    }
+    size_t recvoffset = 0;
+    for(size_t i = 0; i < pattern.recvproc.size(); i++) {
+      add_recv(recvbuf, recvoffset, pattern.recvcount[i], pattern.recvproc[i]);
+      recvoffset += pattern.recvcount[i];
+    }
+    commit();
   }
 
   template <typename T>
@@ -695,119 +1428,568 @@
   template <typename T>
   void Comm<T>::measure(int warmup, int numiter, size_t count) {
     this->report();
-    double minTime;
-    double medTime;
-    double maxTime;
-    double avgTime;
-    CommBench::measure(warmup, numiter, minTime, medTime, maxTime, avgTime, *this);
+    histogram_t hist;
+    std::vector<double> iters;
+    CommBench::measure(warmup, numiter, hist, *this, results_file ? &iters : nullptr);
+    hist.print(count * sizeof(T));
+    record("measure", count, hist, iters);
+    if(coldcache)
+      measure_cold(warmup, numiter, count, hist, *this);
+  };
+  // REPEAT WITH THE CACHES FLUSHED BEFORE EVERY ITERATION AND COMPARE WITH THE HOT MEASUREMENT
+  // comm IS THIS COMMUNICATOR OR A DERIVED ONE (SpComm) WHOSE start() AND wait() ARE MEASURED
+  template <typename T>
+  template <typename C>
+  void Comm<T>::measure_cold(int warmup, int numiter, size_t count, histogram_t &hot, C &comm) {
+    histogram_t hist;
+    std::vector<double> iters;
+    if(myid == printid)
+      printf("******************** COLD CACHE\n");
+    scrubbing = true;
+    CommBench::measure(warmup, numiter, hist, comm, results_file ? &iters : nullptr);
+    scrubbing = false;
+    hot.print(count * sizeof(T), hist);
+    record("measure_cold", count, hist, iters);
+  };
+
+  // WRITE TO THE RESULTS SINK (COLLECTIVE)
+  template <typename T>
+  void Comm<T>::record(const char *mode, size_t count, histogram_t &hist, const std::vector<double> &iters) {
+    size_t sendbytes = 0;
+    size_t recvbytes = 0;
+    for(int send = 0; send < numsend; send++)
+      sendbytes += sendcount[send] * sizeof(T);
+    for(int recv = 0; recv < numrecv; recv++)
+      recvbytes += recvcount[recv] * sizeof(T);
+    results_record(mode, benchid, lib_name(lib), numcomm, count, count * sizeof(T), sendbytes, recvbytes, hist, iters);
+  }
+  // MESSAGE-SIZE SWEEP: THE PATTERN REGISTERED AT THE MAXIMUM SIZE IS MEASURED WITH ALL COUNTS DIVIDED BY 2^step
+  // FOR step = 0, ..., numstep - 1. THE STEPS ARE VISITED IN A RANDOM ORDER THAT IS THE SAME ON ALL PROCESSES
+  template <typename T>
+  std::vector<typename Comm<T>::sweep_t> Comm<T>::measure_sweep(int warmup, int numiter, int numstep) {
+    std::vector<sweep_t> results;
+#ifdef IPC_ze
+    // COMMAND LISTS ARE RECORDED WITH THE REGISTERED COUNTS
+    if(lib == IPC || lib == IPC_get) {
+      if(myid == printid)
+        printf("measure_sweep is not supported with IPC_ze\n");
+      return results;
+    }
+#endif
+    this->report();
+    numstep = std::min(numstep, 64);
+    std::vector<int> order(numstep);
+    for(int step = 0; step < numstep; step++)
+      order[step] = step;
+    std::mt19937 rng(numstep);
+    std::shuffle(order.begin(), order.end(), rng);
+    std::vector<size_t> sendcount_max(sendcount);
+    std::vector<size_t> recvcount_max(recvcount);
+    results.resize(numstep);
+    int printid_temp = printid;
+    printid = -1;
+    for(int step : order) {
+      long count_total = 0;
+      for(int send = 0; send < numsend; send++) {
+        sendcount[send] = sendcount_max[send] >> step;
+        count_total += sendcount[send];
+      }
+      for(int recv = 0; recv < numrecv; recv++)
+        recvcount[recv] = recvcount_max[recv] >> step;
+      allreduce_sum(&count_total);
+      histogram_t hist;
+      std::vector<double> iters;
+      CommBench::measure(warmup, numiter, hist, *this, results_file ? &iters : nullptr);
+      results[numstep - 1 - step] = {(size_t)count_total, hist.min, hist.percentile(0.5), hist.percentile(0.99), hist.max, hist.mean()};
+      record("sweep", count_total, hist, iters);
+    }
+    printid = printid_temp;
+    sendcount = sendcount_max;
+    recvcount = recvcount_max;
     if(myid == printid) {
-      size_t data = count * sizeof(T);
-      printf("data: "); print_data(data); printf("\n");
-      printf("minTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", minTime * 1e6, minTime / data * 1e12, data / minTime / 1e9);
-      printf("medTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", medTime * 1e6, medTime / data * 1e12, data / medTime / 1e9);
-      printf("maxTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", maxTime * 1e6, maxTime / data * 1e12, data / maxTime / 1e9);
-      printf("avgTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", avgTime * 1e6, avgTime / data * 1e12, data / avgTime / 1e9);
+      printf("Bench %d sweep of %d sizes (measured in random order):\n", benchid, numstep);
+      printf("data minTime(us) medTime(us) p99Time(us) maxTime(us) medBW(GB/s)\n");
+      for(sweep_t &r : results) {
+        size_t data = r.count * sizeof(T);
+        print_data(data);
+        printf(" %.4e %.4e %.4e %.4e %.4e\n", r.minTime * 1e6, r.medTime * 1e6, r.p99Time * 1e6, r.maxTime * 1e6, data / r.medTime / 1e9);
+      }
       printf("\n");
     }
-  };
+    return results;
+  }
 
+  // WINDOWED MEASUREMENT: EACH ITERATION TIMES window BACK-TO-BACK CALLS
   template <typename T>
-  void Comm<T>::report() {
+  void Comm<T>::measure_window(int warmup, int numiter, int window, size_t count) {
+    this->report();
+    histogram_t hist;
+    if(myid == printid)
+      printf("%d warmup iterations of %d back-to-back calls\n", warmup, window);
+    for(int iter = -warmup; iter < numiter; iter++) {
+      barrier();
+      trace("iteration", 'B', -1, iter);
+      double time = wtime();
+      start(window);
+      wait(window);
+      time = timer_correct(wtime() - time);
+      trace("iteration", 'E', -1, iter);
+      allreduce_max(&time);
+      if(iter >= 0)
+        hist.add(time / window);
+    }
+    if(myid == printid)
+      printf("%d measurement iterations of %d back-to-back calls (per-call statistics):\n", numiter, window);
+    hist.print(count * sizeof(T));
+    record("window", count, hist, std::vector<double>());
+    if(myid == printid) {
+      printf("message rate (%d messages per call): %.4e msg/s median, %.4e msg/s max\n", numcomm, numcomm / hist.percentile(0.5), numcomm / hist.min);
+      printf("call rate: %.4e calls/s median, %.4e calls/s max\n\n", 1 / hist.percentile(0.5), 1 / hist.min);
+    }
+  }
 
-    std::vector<size_t> matrix = getMatrix();
+  // PING-PONG LATENCY AND STREAMING MESSAGE RATE: EACH REGISTERED MESSAGE IS A PAIR, ALL PAIRS RUN SIMULTANEOUSLY
+  // THE RETURN MESSAGES (FULL SIZE FOR PING-PONG, ONE ELEMENT FOR ACKNOWLEDGEMENT) ARE REGISTERED IN REVERSE
+  template <typename T>
+  void Comm<T>::measure_pingpong(int warmup, int numiter, int window) {
+    this->report();
+    Comm<T> reverse(lib);
+    Comm<T> ack(lib);
+    // ACKNOWLEDGEMENTS GO THROUGH A PRIVATE SCRATCH BUFFER, ONE ELEMENT PER MESSAGE, SO THAT THE USER DATA IS NOT OVERWRITTEN
+    T *scratch;
+    CommBench::allocate(scratch, numsend + numrecv + 1);
+    for(int recv = 0; recv < numrecv; recv++) {
+      reverse.add_send(recvbuf[recv], recvoffset[recv], recvcount[recv], recvproc[recv]);
+      ack.add_send(scratch, numsend + recv, 1, recvproc[recv]);
+    }
+    for(int send = 0; send < numsend; send++) {
+      reverse.add_recv(sendbuf[send], sendoffset[send], sendcount[send], sendproc[send]);
+      ack.add_recv(scratch, send, 1, sendproc[send]);
+    }
+    reverse.commit();
+    ack.commit();
+    long count_total = 0;
+    for(int send = 0; send < numsend; send++)
+      count_total += sendcount[send];
+    allreduce_sum(&count_total);
 
+    // PING-PONG: EACH SENDER TIMES ITS OWN ROUND TRIPS WITHOUT BARRIERS, HISTOGRAMS ARE MERGED ACROSS PROCESSES
+    histogram_t latency;
+    barrier();
+    for(int iter = -warmup; iter < numiter; iter++) {
+      double time = wtime();
+      start();
+      wait();
+      reverse.start();
+      reverse.wait();
+      time = timer_correct(wtime() - time);
+      if(iter >= 0 && numsend)
+        latency.add(time / 2);
+    }
+    latency.allreduce();
+
+    // STREAMING: window MESSAGES PER PAIR FOLLOWED BY AN ACKNOWLEDGEMENT
+    histogram_t stream;
+    for(int iter = -warmup; iter < numiter; iter++) {
+      barrier();
+      double time = wtime();
+      start(window);
+      wait(window);
+      ack.start();
+      ack.wait();
+      time = timer_correct(wtime() - time);
+      allreduce_max(&time);
+      if(iter >= 0)
+        stream.add(time);
+    }
+    reverse.release();
+    ack.release();
+    CommBench::free(scratch);
+
+    if(myid == printid)
+      printf("ping-pong of %d pairs, %lu round trips (one-way latency):\n", numcomm, latency.count);
+    latency.print(count_total * sizeof(T));
+    record("pingpong", count_total, latency, std::vector<double>());
     if(myid == printid) {
-      printf("\nCommBench %d: ", benchid);
-      print_lib(lib);
-      printf(" communication matrix (reciever x sender) nnz: %d\n", numcomm);
-      for(int recver = 0; recver < numproc; recver++) {
-        for(int sender = 0; sender < numproc; sender++) {
-          size_t count = matrix[recver * numproc + sender];
-          if(count)
-            printf("%ld ", count);
-            // printf("1 ");
-          else
-            printf(". ");
+      double median = stream.percentile(0.5);
+      printf("streaming window of %d messages per pair:\n", window);
+      printf("message rate: %.4e msg/s per pair, %.4e msg/s aggregate (median)\n", window / median, (double)numcomm * window / median);
+      printf("message rate: %.4e msg/s per pair, %.4e msg/s aggregate (max)\n", window / stream.min, (double)numcomm * window / stream.min);
+      printf("bandwidth: %.4e GB/s aggregate (median)\n\n", count_total * sizeof(T) * window / median / 1e9);
+    }
+  }
+
+  // OVERLAP OF COMMUNICATION WITH A SYNTHETIC WORKLOAD BETWEEN start() AND wait()
+  // THE WORKLOAD IS CALIBRATED ON EACH PROCESS TO TAKE fraction OF THE MEDIAN COMMUNICATION TIME
+  // overlap: hidden fraction of the shorter of the two, slowdown: workload time next to communication over workload time alone
+  template <typename T>
+  void Comm<T>::measure_overlap(int warmup, int numiter, double fraction) {
+    this->report();
+    long count_total = 0;
+    for(int send = 0; send < numsend; send++)
+      count_total += sendcount[send];
+    allreduce_sum(&count_total);
+
+    // COMMUNICATION ALONE
+    histogram_t comm;
+    for(int iter = -warmup; iter < numiter; iter++) {
+      barrier();
+      double time = wtime();
+      start();
+      wait();
+      time = timer_correct(wtime() - time);
+      allreduce_max(&time);
+      if(iter >= 0)
+        comm.add(time);
+    }
+    double comm_time = comm.percentile(0.5);
+    record("overlap_comm", count_total, comm, std::vector<double>());
+
+    const char *name[2] = {"compute", "memory"};
+    void (*kernel[2])(size_t) = {workload_compute, workload_memory};
+    double stats[2][5];
+    for(int k = 0; k < 2; k++) {
+      size_t work = workload_calibrate(kernel[k], fraction * comm_time);
+      // WORKLOAD ALONE
+      histogram_t alone;
+      for(int iter = -warmup; iter < numiter; iter++) {
+        barrier();
+        double time = wtime();
+        kernel[k](work);
+        time = timer_correct(wtime() - time);
+        allreduce_max(&time);
+        if(iter >= 0)
+          alone.add(time);
+      }
+      // WORKLOAD BETWEEN start() AND wait()
+      histogram_t busy;
+      histogram_t total;
+      for(int iter = -warmup; iter < numiter; iter++) {
+        barrier();
+        trace("iteration", 'B', -1, iter);
+        double time = wtime();
+        start();
+        double comp = wtime();
+        kernel[k](work);
+        comp = timer_correct(wtime() - comp);
+        wait();
+        time = timer_correct(wtime() - time);
+        trace("iteration", 'E', -1, iter);
+        allreduce_max(&comp);
+        allreduce_max(&time);
+        if(iter >= 0) {
+          busy.add(comp);
+          total.add(time);
         }
-        printf("\n");
+      }
+      record(k == 0 ? "overlap_compute" : "overlap_memory", count_total, total, std::vector<double>());
+      double comp_time = alone.percentile(0.5);
+      double total_time = total.percentile(0.5);
+      double overlap = (comm_time + comp_time - total_time) / std::min(comm_time, comp_time);
+      stats[k][0] = comp_time;
+      stats[k][1] = busy.percentile(0.5);
+      stats[k][2] = total_time;
+      stats[k][3] = 100 * std::min(std::max(overlap, 0.0), 1.0);
+      stats[k][4] = busy.percentile(0.5) / comp_time;
+    }
+    if(myid == printid) {
+      printf("overlap with %s: communication %.4e us (median), workload %.2f of communication\n", lib_name(lib), comm_time * 1e6, fraction);
+      printf("workload alone(us) overlapped(us) total(us) overlap(%%) slowdown\n");
+      for(int k = 0; k < 2; k++)
+        printf("%s %.4e %.4e %.4e %.1f %.2f\n", name[k], stats[k][0] * 1e6, stats[k][1] * 1e6, stats[k][2] * 1e6, stats[k][3], stats[k][4]);
+      printf("\n");
+    }
+  }
+
+  // COPY ENGINE SCALING: THE PATTERN IS MEASURED WITH 1, 2, 4, ... COPY THREADS UP TO THE ALLOWED CPUS OF THE PROCESSES
+  template <typename T>
+  void Comm<T>::measure_copy(int warmup, int numiter) {
+#if defined PORT_CUDA || defined PORT_HIP || defined PORT_ONEAPI
+    if(myid == printid)
+      printf("measure_copy: the copy engine is used by the CPU port only\n");
+    return;
+#endif
+    this->report();
+    long count_total = 0;
+    for(int send = 0; send < numsend; send++)
+      count_total += sendcount[send];
+    allreduce_sum(&count_total);
+    int maxthread = copy_engine.maxthread();
+    allreduce_max(&maxthread);
+    std::vector<int> numthread;
+    for(int thread = 1; thread < maxthread; thread *= 2)
+      numthread.push_back(thread);
+    numthread.push_back(maxthread);
+    std::vector<double> medtime;
+    int copythread_temp = copythread;
+    for(int thread : numthread) {
+      copythread = thread;
+      histogram_t hist;
+      for(int iter = -warmup; iter < numiter; iter++) {
+        barrier();
+        double time = wtime();
+        start();
+        wait();
+        time = timer_correct(wtime() - time);
+        allreduce_max(&time);
+        if(iter >= 0)
+          hist.add(time);
+      }
+      medtime.push_back(hist.percentile(0.5));
+      char mode[32];
+      snprintf(mode, sizeof(mode), "copy_%d", thread);
+      record(mode, count_total, hist, std::vector<double>());
+    }
+    copythread = copythread_temp;
+    if(myid == printid) {
+      printf("copy engine of %s with %d-byte chunks, ", lib_name(lib), COMMBENCH_COPY_CHUNK);
+      print_data(count_total * sizeof(T));
+      printf(" in total\n");
+      printf("threads medTime(us) GB/s speedup\n");
+      for(size_t i = 0; i < numthread.size(); i++)
+        printf("%d %.4e %.4e %.2f\n", numthread[i], medtime[i] * 1e6, count_total * sizeof(T) / medtime[i] / 1e9, medtime[0] / medtime[i]);
+      printf("\n");
+    }
+  }
+
+  // FIT THE MODEL OF THIS LIBRARY FROM A SWEEP OF THE REGISTERED PATTERN, WHICH MUST BE OF A SINGLE LINK CLASS
+  // TIMES ARE FITTED AGAINST THE AVERAGE MESSAGE SIZE, A SINGLE PAIR GIVES THE POINT-TO-POINT MODEL
+  template <typename T>
+  void Comm<T>::fit(model_t &model, int warmup, int numiter, int numstep) {
+    find_nodes();
+    int link[2] = {numlink, -1};
+    for(int send = 0; send < numsend; send++) {
+      int l = link_of(myid, sendproc[send]);
+      link[0] = std::min(link[0], l);
+      link[1] = std::max(link[1], l);
+    }
+    link[0] = -link[0];
+    allreduce(link, link, 2, [](const int &a, const int &b) -> int {return (a > b ? a : b);});
+    link[0] = -link[0];
+    if(link[0] != link[1]) {
+      if(myid == printid)
+        printf("Bench %d cannot be fitted: %s\n", benchid, link[1] < 0 ? "no communication" : "mixed link classes");
+      return;
+    }
+    std::vector<sweep_t> sweep = measure_sweep(warmup, numiter, numstep);
+    if(sweep.empty())
+      return;
+    std::vector<double> bytes;
+    std::vector<double> medtime;
+    for(sweep_t &r : sweep) {
+      bytes.push_back((double)r.count * sizeof(T) / numcomm);
+      medtime.push_back(r.medTime);
+    }
+    // SEND OVERHEAD AND GAP OF THE SMALLEST MESSAGE
+    const int window = 16;
+    std::vector<size_t> sendcount_max(sendcount);
+    std::vector<size_t> recvcount_max(recvcount);
+    for(int send = 0; send < numsend; send++)
+      sendcount[send] = std::min(sendcount[send], (size_t)1);
+    for(int recv = 0; recv < numrecv; recv++)
+      recvcount[recv] = std::min(recvcount[recv], (size_t)1);
+    histogram_t overhead;
+    histogram_t single;
+    histogram_t stream;
+    for(int iter = -warmup; iter < numiter; iter++) {
+      barrier();
+      double time = wtime();
+      start();
+      double post = timer_correct(wtime() - time);
+      wait();
+      time = timer_correct(wtime() - time);
+      allreduce_max(&post);
+      allreduce_max(&time);
+      barrier();
+      double time_window = wtime();
+      start(window);
+      wait(window);
+      time_window = timer_correct(wtime() - time_window);
+      allreduce_max(&time_window);
+      if(iter >= 0) {
+        overhead.add(post);
+        single.add(time);
+        stream.add(time_window);
       }
     }
+    sendcount = sendcount_max;
+    recvcount = recvcount_max;
+    double gap = std::max((stream.percentile(0.5) - single.percentile(0.5)) / (window - 1), 0.0);
+    model.fit(lib, link[0], bytes, medtime, overhead.percentile(0.5), gap);
+  }
+
+  // ANALYTICAL TIME OF THE REGISTERED PATTERN: ON EACH PROCESS AND LINK CLASS, THE LARGEST LATENCY IS PAID ONCE,
+  // THE REMAINING MESSAGES ARE INJECTED AT THE GAP, AND THE BYTES ARE SERIALIZED. LINK CLASSES PROCEED IN PARALLEL
+  template <typename T>
+  double Comm<T>::predict(model_t &model) {
+    find_nodes();
+    double time = 0;
+    int missing = 0;
+    for(int dir = 0; dir < 2; dir++) {
+      std::vector<double> alpha(numlink, 0);
+      std::vector<double> serial(numlink, 0);
+      std::vector<int> count(numlink, 0);
+      int num = (dir == 0 ? numsend : numrecv);
+      for(int i = 0; i < num; i++) {
+        int link = (dir == 0 ? link_of(myid, sendproc[i]) : link_of(recvproc[i], myid));
+        double bytes = (dir == 0 ? sendcount[i] : recvcount[i]) * sizeof(T);
+        model_t::entry_t *e = model.find(lib, link);
+        if(e == nullptr) {
+          missing = 1;
+          continue;
+        }
+        alpha[link] = std::max(alpha[link], e->alpha(bytes));
+        serial[link] += e->beta(bytes) * bytes;
+        count[link]++;
+      }
+      for(int link = 0; link < numlink; link++)
+        if(count[link])
+          time = std::max(time, alpha[link] + (count[link] - 1) * model.find(lib, link)->g + serial[link]);
+    }
+    allreduce_max(&time);
+    allreduce_max(&missing);
+    if(myid == printid) {
+      printf("Bench %d predicted time: %.4e us", benchid, time * 1e6);
+      if(missing)
+        printf(" (%s is not modeled for some link classes, they are excluded)", lib_name(lib));
+      printf("\n");
+    }
+    return time;
+  }
+
+  template <typename T>
+  void Comm<T>::measure_adaptive(double precision, double budget) {
+    long count_total = 0;
+    for(int send = 0; send < numsend; send++)
+       count_total += sendcount[send];
+    allreduce_sum(&count_total);
+    this->report();
+    histogram_t hist;
+    CommBench::measure_adaptive(precision, budget, hist, *this);
+    hist.print(count_total * sizeof(T));
+    record("adaptive", count_total, hist, std::vector<double>());
+  }
+
+  template <typename T>
+  std::vector<typename Comm<T>::nonzero_t> Comm<T>::getSparse() {
+    // AGGREGATE LOCAL SENDS PER RECEIVER
+    std::vector<int> order(numsend);
+    for(int send = 0; send < numsend; send++)
+      order[send] = send;
+    std::stable_sort(order.begin(), order.end(), [this](const int &a, const int &b) -> bool {return sendproc[a] < sendproc[b];});
+    std::vector<nonzero_t> local;
+    for(int send : order) {
+      if(local.empty() || local.back().recvid != sendproc[send])
+        local.push_back({myid, sendproc[send], 0, 0});
+      local.back().numcomm++;
+      local.back().count += sendcount[send];
+    }
+    // SINGLE GATHER OF NONZEROS
+    std::vector<nonzero_t> sparse;
+    gather(local, sparse, printid < 0 ? 0 : printid);
+    return sparse;
+  }
+
+  template <typename T>
+  void Comm<T>::report() {
+    report(nullptr);
+  }
+
+  template <typename T>
+  void Comm<T>::report(const char *filename) {
+
+    std::vector<nonzero_t> sparse = getSparse();
     long sendTotal = 0;
     long recvTotal = 0;
     for(int send = 0; send < numsend; send++)
-       sendTotal += sendcount[send];
+      sendTotal += sendcount[send];
     for(int recv = 0; recv < numrecv; recv++)
-       recvTotal += recvcount[recv];
-
+      recvTotal += recvcount[recv];
     allreduce_sum(&sendTotal);
     allreduce_sum(&recvTotal);
 
-    /*int numbuf = buffer_list.size();
-    allreduce_sum(&numbuf);
-    if(numbuf) {
-      int total_buff = buffer_list.size();
-      std::vector<int> total_buffs(numproc);
-      MPI_Allgather(&total_buff, 1, MPI_INT, total_buffs.data(), 1, MPI_INT, comm_mpi);
-      MPI_Allreduce(MPI_IN_PLACE, &total_buff, 1, MPI_INT, MPI_SUM, comm_mpi);
-      long total_count = 0;
-      for(size_t count : buffer_count)
-        total_count += count;
-      std::vector<long> total_counts(numproc);
-      MPI_Allgather(&total_count, sizeof(long), MPI_BYTE, total_counts.data(), sizeof(long), MPI_BYTE, comm_mpi);
-      MPI_Allreduce(MPI_IN_PLACE, &total_count, 1, MPI_LONG, MPI_SUM, comm_mpi);
-      if(myid == printid) {
-        for(int p = 0; p < numproc; p++) {
-          printf("proc %d: %d pieces count %ld ", p, total_buffs[p], total_counts[p]);
-          print_data(total_counts[p] * sizeof(T));
+    if(myid == printid) {
+      printf("\nCommBench %d: ", benchid);
+      print_lib(lib);
+      printf(" communication matrix (reciever x sender) nnz: %d\n", numcomm);
+      if(numproc <= COMMBENCH_DENSE_REPORT) {
+        std::vector<size_t> matrix(numproc * numproc, 0);
+        for(nonzero_t &nz : sparse)
+          matrix[nz.recvid * numproc + nz.sendid] = nz.numcomm;
+        for(int recver = 0; recver < numproc; recver++) {
+          for(int sender = 0; sender < numproc; sender++) {
+            size_t count = matrix[recver * numproc + sender];
+            if(count)
+              printf("%ld ", count);
+            else
+              printf(". ");
+          }
           printf("\n");
         }
-        printf("total pieces: %d count %ld ", total_buff, total_count);
-        print_data(total_count * sizeof(T));
-        printf("\n");
       }
-    }*/
+      else
+        printf("dense matrix of %d processes is omitted\n", numproc);
 
-    if(myid == printid) {
+      // BYTE-WEIGHTED SUMMARY
+      std::vector<size_t> sendcount_proc(numproc, 0);
+      std::vector<size_t> recvcount_proc(numproc, 0);
+      for(nonzero_t &nz : sparse) {
+        sendcount_proc[nz.sendid] += nz.count;
+        recvcount_proc[nz.recvid] += nz.count;
+      }
+      int sendmax = std::max_element(sendcount_proc.begin(), sendcount_proc.end()) - sendcount_proc.begin();
+      int recvmax = std::max_element(recvcount_proc.begin(), recvcount_proc.end()) - recvcount_proc.begin();
+      printf("nonzero pairs: %zu\n", sparse.size());
+      printf("max send: proc %d ", sendmax);
+      print_data(sendcount_proc[sendmax] * sizeof(T));
+      printf("\n");
+      printf("max recv: proc %d ", recvmax);
+      print_data(recvcount_proc[recvmax] * sizeof(T));
+      printf("\n");
+      std::vector<nonzero_t> heavy(sparse);
+      int numheavy = std::min((int)heavy.size(), 4);
+      std::partial_sort(heavy.begin(), heavy.begin() + numheavy, heavy.end(), [](const nonzero_t &a, const nonzero_t &b) -> bool {return a.count > b.count;});
+      for(int i = 0; i < numheavy; i++) {
+        printf("heaviest pair (%d->%d) messages %zu ", heavy[i].sendid, heavy[i].recvid, heavy[i].numcomm);
+        print_data(heavy[i].count * sizeof(T));
+        printf("\n");
+      }
       printf("send footprint: %ld ", sendTotal);
       print_data(sendTotal * sizeof(T));
       printf("\n");
       printf("recv footprint: %ld ", recvTotal);
       print_data(recvTotal * sizeof(T));
       printf("\n");
+
+      // SPARSE OUTPUT
+      if(filename) {
+        FILE *matfile = fopen(filename, "w");
+        if(matfile) {
+          fprintf(matfile, "# CommBench %d numproc %d nnz %zu\n", benchid, numproc, sparse.size());
+          fprintf(matfile, "# sender recver messages bytes\n");
+          for(nonzero_t &nz : sparse)
+            fprintf(matfile, "%d %d %zu %zu\n", nz.sendid, nz.recvid, nz.numcomm, nz.count * sizeof(T));
+          fclose(matfile);
+          printf("sparse matrix is written into %s\n", filename);
+        }
+        else
+          printf("cannot open %s\n", filename);
+      }
       printf("\n");
     }
   }
+
   template <typename T>
   std::vector<size_t> Comm<T>::getMatrix() {
-
-    std::vector<size_t> sendcount_temp(numproc, 0);
-    std::vector<size_t> recvcount_temp(numproc, 0);
-    for (int send = 0; send < numsend; send++)
-      sendcount_temp[sendproc[send]]++;// += sendcount[send];
-    for (int recv = 0; recv < numrecv; recv++)
-      recvcount_temp[recvproc[recv]]++;// += recvcount[recv];
-    std::vector<size_t> sendmatrix(numproc * numproc);
-    std::vector<size_t> recvmatrix(numproc * numproc);
-    for(int i = 0; i < numproc; i++) {
-      allgather(&sendcount_temp[i], &sendmatrix[i * numproc]);
-      allgather(&recvcount_temp[i], &recvmatrix[i * numproc]);
-    }
-    std::vector<size_t> matrix;
-    for (int sender = 0; sender < numproc; sender++)
-      for (int recver = 0; recver < numproc; recver++)
-        matrix.push_back(sendmatrix[sender * numproc + recver]);
-
-    /* if(myid == printid) {
-      char filename[2048];
-      sprintf(filename, "matrix_%d.txt", benchid);
-      FILE *matfile = fopen(filename, "w");
-      for(int recver = 0; recver < numproc; recver++) {
-        for(int sender = 0; sender < numproc; sender++)
-          fprintf(matfile, "%ld ", matrix[sender * numproc + recver]);
-        fprintf(matfile, "\n");
-      }
-      fclose(matfile);
-    }*/
+    std::vector<nonzero_t> sparse = getSparse();
+    int root = (printid < 0 ? 0 : printid);
+    size_t nnz = sparse.size();
+    broadcast(&nnz, &nnz, root);
+    sparse.resize(nnz);
+    broadcast(sparse.data(), sparse.data(), nnz, root);
+    std::vector<size_t> matrix(numproc * numproc, 0);
+    for(nonzero_t &nz : sparse)
+      matrix[nz.sendid * numproc + nz.recvid] = nz.numcomm;
     return matrix;
   }
 
@@ -822,6 +2004,8 @@
 
   template <typename T>
   void Comm<T>::block_sender() {
+    if(!handshake)
+      return;
 #ifdef USE_MPI
     for(int recv = 0; recv < numrecv; recv++)
       MPI_Send(&ack_recver[recv], 1, MPI_INT, recvproc[recv], 0, comm_mpi);
@@ -837,6 +2021,8 @@
   }
   template <typename T>
   void Comm<T>::block_recver() {
+    if(!handshake)
+      return;
 #ifdef USE_MPI
     for(int send = 0; send < numsend; send++)
       MPI_Send(&ack_sender[send], 1, MPI_INT, sendproc[send], 0, comm_mpi);
@@ -853,6 +2039,7 @@
 
   template <typename T>
   void Comm<T>::start() {
+    trace("start", 'B', benchid, -1);
     switch(lib) {
 #ifdef USE_MPI
       case MPI:
@@ -861,6 +2048,22 @@
         for (int recv = 0; recv < numrecv; recv++)
           MPI_Irecv(recvbuf[recv] + recvoffset[recv], recvcount[recv] * sizeof(T), MPI_BYTE, recvproc[recv], 0, comm_mpi, &recvrequest[recv]);
         break;
+      case MPI_persist:
+        persist();
+        MPI_Startall(persistrequest.size(), persistrequest.data());
+        break;
+      case MPI_put:
+        block_sender();
+        for(int send = 0; send < numsend; send++)
+          MPI_Put(sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T), MPI_BYTE, sendproc[send], remotedisp[send], sendcount[send] * sizeof(T), MPI_BYTE, win_rma);
+        break;
+      case MPI_get:
+        if(numsend)
+          MPI_Win_sync(win_rma); // LOCAL WRITES OF THE SOURCES ARE VISIBLE TO THE GETS
+        block_recver();
+        for(int recv = 0; recv < numrecv; recv++)
+          MPI_Get(recvbuf[recv] + recvoffset[recv], recvcount[recv] * sizeof(T), MPI_BYTE, recvproc[recv], remotedisp[recv], recvcount[recv] * sizeof(T), MPI_BYTE, win_rma);
+        break;
 #endif
       case NCCL:
 #ifdef CAP_NCCL
@@ -893,6 +2096,8 @@
           hipMemcpyAsync(remotebuf[send] + remoteoffset[send], sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T), hipMemcpyDeviceToDevice, stream_ipc[send]);
   #elif defined PORT_ONEAPI && !defined IPC_ze
           q_ipc[send].memcpy(remotebuf[send] + remoteoffset[send], sendbuf[send] + sendoffset[send], sendcount[send] * sizeof(T));
+  #elif !defined PORT_ONEAPI
+          ipc_copy(pid_ipc[send], (char*)(sendbuf[send] + sendoffset[send]), (char*)(remotebuf[send] + remoteoffset[send]), sendcount[send] * sizeof(T), true);
   #endif
 #endif
         }
@@ -922,6 +2127,8 @@
           hipMemcpyAsync(recvbuf[recv] + recvoffset[recv], remotebuf[recv] + remoteoffset[recv], recvcount[recv] * sizeof(T), hipMemcpyDeviceToDevice, stream_ipc[recv]);
   #elif defined PORT_ONEAPI && !defined IPC_ze
           q_ipc[recv].memcpy(recvbuf[recv] + recvoffset[recv], remotebuf[recv] + remoteoffset[recv], recvcount[recv] * sizeof(T));
+  #elif !defined PORT_ONEAPI
+          ipc_copy(pid_ipc[recv], (char*)(recvbuf[recv] + recvoffset[recv]), (char*)(remotebuf[recv] + remoteoffset[recv]), recvcount[recv] * sizeof(T), false);
   #endif
 #endif
         }
@@ -952,16 +2159,70 @@
         printf(" option is not implemented!\n");
         break;
     }
+    trace("start", 'E', benchid, -1);
   }
 
   template <typename T>
   void Comm<T>::wait() {
+    trace("wait", 'B', benchid, -1);
     switch(lib) {
 #ifdef USE_MPI
       case MPI:
+        if(tracing) {
+          // RECORD THE COMPLETION OF EACH MESSAGE
+          int numdone = 0;
+          while(numdone < numsend + numrecv) {
+            int index;
+            int flag;
+            MPI_Testany(numsend, sendrequest.data(), &index, &flag, MPI_STATUS_IGNORE);
+            if(flag && index != MPI_UNDEFINED) {
+              trace("send", 'i', benchid, index);
+              numdone++;
+            }
+            MPI_Testany(numrecv, recvrequest.data(), &index, &flag, MPI_STATUS_IGNORE);
+            if(flag && index != MPI_UNDEFINED) {
+              trace("recv", 'i', benchid, index);
+              numdone++;
+            }
+          }
+          break;
+        }
         MPI_Waitall(numsend, sendrequest.data(), MPI_STATUSES_IGNORE);
         MPI_Waitall(numrecv, recvrequest.data(), MPI_STATUSES_IGNORE);
         break;
+      case MPI_persist:
+        if(tracing) {
+          int numdone = 0;
+          while(numdone < (int)persistrequest.size()) {
+            int index;
+            int flag;
+            MPI_Testany(persistrequest.size(), persistrequest.data(), &index, &flag, MPI_STATUS_IGNORE);
+            if(flag && index != MPI_UNDEFINED) {
+              if(index < numrecv)
+                trace("recv", 'i', benchid, index);
+              else
+                trace("send", 'i', benchid, index - numrecv);
+              numdone++;
+            }
+          }
+          break;
+        }
+        MPI_Waitall(persistrequest.size(), persistrequest.data(), MPI_STATUSES_IGNORE);
+        break;
+      case MPI_put:
+        // REMOTE COMPLETION, THEN NOTIFY THE TARGETS
+        if(numsend)
+          MPI_Win_flush_all(win_rma);
+        block_recver();
+        if(numrecv)
+          MPI_Win_sync(win_rma);
+        break;
+      case MPI_get:
+        // LOCAL COMPLETION, THEN RELEASE THE ORIGINS
+        if(numrecv)
+          MPI_Win_flush_all(win_rma);
+        block_sender();
+        break;
 #endif
       case NCCL:
 #if defined CAP_NCCL && defined PORT_CUDA
@@ -1021,4 +2282,60 @@
         printf(" option is not implemented!\n");
         break;
     }
+    trace("wait", 'E', benchid, -1);
+  }
+
+  // BACK-TO-BACK EXECUTION: THE HANDSHAKES OF IPC AND GASNET ARE MADE ONCE PER WINDOW,
+  // MPI REQUESTS AND GASNET EVENTS OF EARLIER CALLS ARE KEPT UNTIL THE WINDOW IS WAITED
+  template <typename T>
+  void Comm<T>::start(int window) {
+#ifdef USE_MPI
+    // ALL SETS ARE STARTED IN THE SAME ORDER ON ALL PROCESSES, SO THAT THE MESSAGES OF A CALL MATCH EACH OTHER
+    if(lib == MPI_persist && window > 1) {
+      persist(window);
+      for(int w = 0; w < window - 1; w++) {
+        MPI_Startall(persistwindow[w].size(), persistwindow[w].data());
+        windowrequest.insert(windowrequest.end(), persistwindow[w].begin(), persistwindow[w].end());
+      }
+      start();
+      return;
+    }
+#endif
+    for(int w = 0; w < window; w++) {
+      handshake = (w == 0);
+      start();
+      if(w == window - 1)
+        break;
+      switch(lib) {
+#ifdef USE_MPI
+        case MPI:
+          windowrequest.insert(windowrequest.end(), sendrequest.begin(), sendrequest.end());
+          windowrequest.insert(windowrequest.end(), recvrequest.begin(), recvrequest.end());
+          break;
+#endif
+#ifdef CAP_GASNET
+        case GEX:
+        case GEX_get:
+          gex_event_window.insert(gex_event_window.end(), gex_event.begin(), gex_event.end());
+          break;
+#endif
+        default:
+          break;
+      }
+    }
+    handshake = true;
+  }
+
+  template <typename T>
+  void Comm<T>::wait(int /*window*/) {
+#ifdef USE_MPI
+    MPI_Waitall(windowrequest.size(), windowrequest.data(), MPI_STATUSES_IGNORE);
+    windowrequest.clear();
+#endif
+#ifdef CAP_GASNET
+    for(gex_Event_t &event : gex_event_window)
+      gex_Event_Wait(event);
+    gex_event_window.clear();
+#endif
+    wait();
   }
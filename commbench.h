@@ -84,21 +84,52 @@
 #include <string.h> // for memcpy
 #include <algorithm> // for std::sort
 #include <vector> // for std::vector
+#include <string> // for std::string
+#include <atomic> // for std::atomic
+#include <random> // for std::mt19937
+#include <list> // for std::list
+#include <thread> // for std::thread
+#include <mutex> // for std::mutex
+#include <condition_variable> // for std::condition_variable
+#include <functional> // for std::function
+#include <stdarg.h> // for va_list
+#include <time.h> // for strftime
 #include <omp.h> // for omp_get_wtime()
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h> // for __rdtscp
+#include <cpuid.h> // for __get_cpuid
+#endif
 #include <unistd.h> // for fd
 #include <sys/syscall.h> // for syscall
+#include <sys/mman.h> // for mmap
+#include <sys/uio.h> // for process_vm_writev
+#include <sys/prctl.h> // for prctl
+#include <errno.h> // for errno
+#include <sched.h> // for sched_getaffinity
+#include <pthread.h> // for pthread_setaffinity_np
+#include <dirent.h> // for opendir
+#include <sys/stat.h> // for fstat
+#include <fcntl.h> // for open
+#include <stdint.h> // for uint64_t
+#include <math.h> // for ceil
 
 namespace CommBench
 {
   static int printid = 0;
+  static bool perrank = false; // report per-process breakdown of measurements
+  static bool sharedmemory = false; // CPU buffers are allocated collectively in node-wide shared memory
+  static bool ipc_ptracer = false; // CPU IPC lets any process attach to this one, for Yama-restricted systems
   static int numbench = 0;
   static std::vector<void*> benchlist;
   static int mydevice = -1;
 
-  enum library {dummy, MPI, NCCL, IPC, IPC_get, GEX, GEX_get, numlib};
+  enum library {dummy, MPI, NCCL, IPC, IPC_get, GEX, GEX_get, MPI_persist, MPI_put, MPI_get, numlib};
 
 #ifdef USE_MPI
   static MPI_Comm comm_mpi;
+  static MPI_Win win_rma = MPI_WIN_NULL; // DYNAMIC WINDOW OF MPI_put AND MPI_get
+  static std::vector<std::pair<char*, char*>> rma_region; // ATTACHED REGIONS, DISJOINT
+  static std::vector<std::pair<char*, char*>> rma_attached; // ATTACHMENTS, ONE PER rma_attach UNTIL ITS rma_detach
 #endif
   static int myid;
   static int numproc;
@@ -132,17 +163,24 @@ namespace CommBench
     else
       printf("%.4f TB", data / 1e12);
   }
-  static void print_lib(library lib) {
+  static const char *lib_name(library lib) {
     switch(lib) {
-      case dummy      : printf("dummy");        break;
-      case IPC        : printf("IPC (PUT)");    break;
-      case IPC_get    : printf("IPC (GET)");    break;
-      case MPI        : printf("MPI");          break;
-      case NCCL       : printf("NCCL");         break;
-      case GEX        : printf("GASNET (PUT)"); break;
-      case GEX_get    : printf("GASNET (GET)"); break;
-      case numlib     : printf("numlib");       break;
+      case dummy      : return "dummy";
+      case IPC        : return "IPC (PUT)";
+      case IPC_get    : return "IPC (GET)";
+      case MPI        : return "MPI";
+      case NCCL       : return "NCCL";
+      case GEX        : return "GASNET (PUT)";
+      case GEX_get    : return "GASNET (GET)";
+      case MPI_persist: return "MPI (PERSISTENT)";
+      case MPI_put    : return "MPI (PUT)";
+      case MPI_get    : return "MPI (GET)";
+      case numlib     : return "numlib";
     }
+    return "unknown";
+  }
+  static void print_lib(library lib) {
+    printf("%s", lib_name(lib));
   }
 
   // MEMORY MANAGEMENT
@@ -152,6 +190,8 @@ namespace CommBench
   template <typename T>
   void allocateHost(T *&buffer, size_t n);
   template <typename T>
+  void allocateShared(T *&buffer, size_t n);
+  template <typename T>
   void memcpyD2H(T *host, T *device, size_t n);
   template <typename T>
   void memcpyH2D(T *device, T *host, size_t n);
@@ -176,26 +216,63 @@ namespace CommBench
   };
 #endif
   template <typename T>
-  void send(T *sendbuf, int recvid) {
+  void send(T *sendbuf, size_t count, int recvid) {
 #ifdef USE_GASNET
-    GASNET_BLOCKUNTIL(am_ready[recvid]);
-    am_ready[recvid] = false;
-    gex_AM_RequestMedium0(myteam, recvid, am_send_index, sendbuf, sizeof(T), GEX_EVENT_NOW, 0);
+    // MEDIUM AM PAYLOAD IS BOUNDED, SEND IN CHUNKS
+    size_t chunk = gex_AM_LUBRequestMedium();
+    size_t bytes = count * sizeof(T);
+    for(size_t i = 0; i < bytes; i += chunk) {
+      GASNET_BLOCKUNTIL(am_ready[recvid]);
+      am_ready[recvid] = false;
+      gex_AM_RequestMedium0(myteam, recvid, am_send_index, (char*)sendbuf + i, std::min(chunk, bytes - i), GEX_EVENT_NOW, 0);
+    }
 #else
-    MPI_Ssend(sendbuf, sizeof(T), MPI_BYTE, recvid, 0, comm_mpi);
+    MPI_Ssend(sendbuf, count * sizeof(T), MPI_BYTE, recvid, 0, comm_mpi);
 #endif
   };
   template <typename T>
-  void recv(T *recvbuf, int sendid) {
+  void recv(T *recvbuf, size_t count, int sendid) {
 #ifdef USE_GASNET
-    am_ptr = recvbuf;
-    am_busy = true;
-    gex_AM_RequestShort1(myteam, sendid, am_recv_index, 0, myid);
-    GASNET_BLOCKUNTIL(!am_busy);
+    size_t chunk = gex_AM_LUBRequestMedium();
+    size_t bytes = count * sizeof(T);
+    for(size_t i = 0; i < bytes; i += chunk) {
+      am_ptr = (char*)recvbuf + i;
+      am_busy = true;
+      gex_AM_RequestShort1(myteam, sendid, am_recv_index, 0, myid);
+      GASNET_BLOCKUNTIL(!am_busy);
+    }
 #else
-    MPI_Recv(recvbuf, sizeof(T), MPI_BYTE, sendid, 0, comm_mpi, MPI_STATUS_IGNORE);
+    MPI_Recv(recvbuf, count * sizeof(T), MPI_BYTE, sendid, 0, comm_mpi, MPI_STATUS_IGNORE);
 #endif
   };
+  template <typename T> void send(T *sendbuf, int recvid) { send(sendbuf, 1, recvid); };
+  template <typename T> void recv(T *recvbuf, int sendid) { recv(recvbuf, 1, sendid); };
+  // SIMULTANEOUS SEND & RECEIVE, SAFE FOR CYCLIC PATTERNS
+  template <typename T>
+  void sendrecv(T *sendbuf, size_t sendcount, int recvid, T *recvbuf, size_t recvcount, int sendid) {
+#ifdef USE_GASNET
+    // POST READINESS BEFORE SENDING SO THAT NEIGHBORS NEVER WAIT ON EACH OTHER
+    size_t chunk = gex_AM_LUBRequestMedium();
+    size_t sendbytes = sendcount * sizeof(T);
+    size_t recvbytes = recvcount * sizeof(T);
+    for(size_t i = 0; i < std::max(sendbytes, recvbytes); i += chunk) {
+      if(i < recvbytes) {
+        am_ptr = (char*)recvbuf + i;
+        am_busy = true;
+        gex_AM_RequestShort1(myteam, sendid, am_recv_index, 0, myid);
+      }
+      if(i < sendbytes) {
+        GASNET_BLOCKUNTIL(am_ready[recvid]);
+        am_ready[recvid] = false;
+        gex_AM_RequestMedium0(myteam, recvid, am_send_index, (char*)sendbuf + i, std::min(chunk, sendbytes - i), GEX_EVENT_NOW, 0);
+      }
+      if(i < recvbytes)
+        GASNET_BLOCKUNTIL(!am_busy);
+    }
+#else
+    MPI_Sendrecv(sendbuf, sendcount * sizeof(T), MPI_BYTE, recvid, 0, recvbuf, recvcount * sizeof(T), MPI_BYTE, sendid, 0, comm_mpi, MPI_STATUS_IGNORE);
+#endif
+  }
   template <typename T>
   void pair(T *sendbuf, T *recvbuf, int sendid, int recvid) {
     if(sendid == recvid) {
@@ -208,53 +285,517 @@ namespace CommBench
     if(myid == recvid)
       recv(recvbuf, sendid);
   }
+  // BINOMIAL TREE: O(log P) STEPS
   template <typename T>
-  void broadcast(T *sendbuf, T *recvbuf, int root) {
-    T temp;
-    for(int i = 0; i < numproc; i++)
-      pair(sendbuf, &temp, root, i);
-    *recvbuf = temp;
+  void broadcast(T *sendbuf, T *recvbuf, size_t count, int root) {
+    std::vector<T> temp(count);
+    if(myid == root)
+      memcpy(temp.data(), sendbuf, count * sizeof(T));
+    int vid = (myid - root + numproc) % numproc;
+    int mask = 1;
+    while(mask < numproc) {
+      if(vid & mask) {
+        recv(temp.data(), count, (myid - mask + numproc) % numproc);
+        break;
+      }
+      mask <<= 1;
+    }
+    for(mask >>= 1; mask > 0; mask >>= 1)
+      if(vid + mask < numproc)
+        send(temp.data(), count, (myid + mask) % numproc);
+    memcpy(recvbuf, temp.data(), count * sizeof(T));
   }
+  template <typename T> void broadcast(T *sendbuf, T *recvbuf, int root) { broadcast(sendbuf, recvbuf, 1, root); };
   template <typename T> void broadcast(T *sendbuf) { broadcast(sendbuf, sendbuf, 0); };
+  // BRUCK: O(log P) STEPS, O(P) DATA PER PROCESS
   template <typename T>
   void allgather(T *sendval, T *recvbuf) {
-    for(int root = 0; root < numproc; root++)
-      broadcast(sendval, recvbuf + root, root);
+    std::vector<T> temp(numproc);
+    memcpy(temp.data(), sendval, sizeof(T));
+    for(int dist = 1; dist < numproc; dist *= 2) {
+      int count = std::min(dist, numproc - dist);
+      sendrecv(temp.data(), count, (myid - dist + numproc) % numproc, temp.data() + dist, count, (myid + dist) % numproc);
+    }
+    for(int i = 0; i < numproc; i++)
+      memcpy(recvbuf + (myid + i) % numproc, temp.data() + i, sizeof(T));
+  }
+  // RECURSIVE DOUBLING: O(log P) STEPS, EXCESS OF POWER OF TWO IS FOLDED
+  // THE OPERATOR MUST BE COMMUTATIVE SO THAT ALL PROCESSES FIND IDENTICAL RESULTS
+  template <typename T, typename Op>
+  void allreduce(T *sendbuf, T *recvbuf, size_t count, Op op) {
+    std::vector<T> value(sendbuf, sendbuf + count);
+    std::vector<T> temp(count);
+    int pof2 = 1;
+    while(pof2 * 2 <= numproc)
+      pof2 *= 2;
+    int rem = numproc - pof2;
+    if(myid >= pof2)
+      send(value.data(), count, myid - pof2);
+    else if(myid < rem) {
+      recv(temp.data(), count, myid + pof2);
+      for(size_t i = 0; i < count; i++)
+        value[i] = op(value[i], temp[i]);
+    }
+    if(myid < pof2)
+      for(int mask = 1; mask < pof2; mask <<= 1) {
+        int partner = myid ^ mask;
+        sendrecv(value.data(), count, partner, temp.data(), count, partner);
+        for(size_t i = 0; i < count; i++)
+          value[i] = op(value[i], temp[i]);
+      }
+    if(myid < rem)
+      send(value.data(), count, myid + pof2);
+    else if(myid >= pof2)
+      recv(value.data(), count, myid - pof2);
+    std::copy(value.begin(), value.end(), recvbuf);
   }
   template <typename T>
   void allreduce_sum(T *sendbuf, T *recvbuf) {
-    std::vector<T> temp(numproc);
-    allgather(sendbuf, temp.data());
-    T sum = 0;
-    for(int i = 0; i < numproc; i++)
-      sum += temp[i];
-    *recvbuf = sum;
+    allreduce(sendbuf, recvbuf, 1, [](const T &a, const T &b) -> T {return a + b;});
   }
   template <typename T> void allreduce_sum(T *sendbuf) { allreduce_sum(sendbuf, sendbuf); }
   template <typename T>
   void allreduce_max(T *sendbuf, T *recvbuf) {
-    std::vector<T> temp(numproc);
-    allgather(sendbuf, temp.data());
-    T max = *sendbuf;
-    for(int i = 0; i < numproc; i++)
-      if(temp[i] > max)
-        max = temp[i];
-    *recvbuf = max;
+    allreduce(sendbuf, recvbuf, 1, [](const T &a, const T &b) -> T {return (a > b ? a : b);});
   }
   template <typename T> void allreduce_max(T *sendbuf) { allreduce_max(sendbuf, sendbuf); }
 
   char allreduce_land(char logic) {
-    std::vector<char> temp(numproc);
-    allgather(&logic, temp.data());
-    for(int i = 0; i < numproc; i++)
-      if(temp[i] == 0)
-        return 0;
-    return 1;
+    allreduce(&logic, &logic, 1, [](const char &a, const char &b) -> char {return (a && b);});
+    return logic;
+  }
+
+  // GATHER VARIABLE-SIZE LISTS ON ROOT IN RANK ORDER
+  template <typename T>
+  void gather(std::vector<T> &sendlist, std::vector<T> &recvlist, int root) {
+#ifdef USE_GASNET
+    recvlist.clear();
+    for(int p = 0; p < numproc; p++) {
+      size_t count = sendlist.size();
+      pair(&count, &count, p, root);
+      if(myid == root) {
+        size_t displ = recvlist.size();
+        recvlist.resize(displ + count);
+        if(p == root)
+          std::copy(sendlist.begin(), sendlist.end(), recvlist.begin() + displ);
+        else
+          recv(recvlist.data() + displ, count, p);
+      }
+      else if(myid == p)
+        send(sendlist.data(), count, root);
+    }
+#else
+    // COUNTED IN ELEMENTS, WITH THE LARGE-COUNT VARIANT IF AVAILABLE
+    MPI_Datatype type;
+    MPI_Type_contiguous(sizeof(T), MPI_BYTE, &type);
+    MPI_Type_commit(&type);
+#if MPI_VERSION >= 4
+    MPI_Count sendcount = sendlist.size();
+    std::vector<MPI_Count> recvcount(numproc);
+    MPI_Gather(&sendcount, 1, MPI_COUNT, recvcount.data(), 1, MPI_COUNT, root, comm_mpi);
+    std::vector<MPI_Aint> recvdispl(numproc + 1, 0);
+    for(int p = 0; p < numproc; p++)
+      recvdispl[p + 1] = recvdispl[p] + recvcount[p];
+    if(myid == root)
+      recvlist.resize(recvdispl[numproc]);
+    MPI_Gatherv_c(sendlist.data(), sendcount, type, recvlist.data(), recvcount.data(), recvdispl.data(), type, root, comm_mpi);
+#else
+    int sendcount = sendlist.size();
+    std::vector<int> recvcount(numproc);
+    MPI_Gather(&sendcount, 1, MPI_INT, recvcount.data(), 1, MPI_INT, root, comm_mpi);
+    std::vector<int> recvdispl(numproc + 1, 0);
+    for(int p = 0; p < numproc; p++)
+      recvdispl[p + 1] = recvdispl[p] + recvcount[p];
+    if(myid == root)
+      recvlist.resize(recvdispl[numproc]);
+    MPI_Gatherv(sendlist.data(), sendcount, type, recvlist.data(), recvcount.data(), recvdispl.data(), type, root, comm_mpi);
+#endif
+    MPI_Type_free(&type);
+#endif
+  }
+
+  // PERSONALIZED EXCHANGE: sendlist[p] is delivered to recvlist[myid] on process p
+  template <typename T>
+  void alltoallv(std::vector<std::vector<T>> &sendlist, std::vector<std::vector<T>> &recvlist) {
+    recvlist.resize(numproc);
+#ifdef USE_GASNET
+    // GASNET-EX HAS NO PERSONALIZED COLLECTIVE: SHIFTED PAIRWISE EXCHANGE IN numproc - 1 STEPS
+    // ALL COUNTS ARE EXCHANGED FIRST, THEN EACH LIST IS SENT AS A WHOLE WHILE THE LIST OF THE OPPOSITE PEER IS RECEIVED
+    std::vector<size_t> sendcount(numproc);
+    std::vector<size_t> recvcount(numproc);
+    for(int p = 0; p < numproc; p++)
+      sendcount[p] = sendlist[p].size();
+    recvcount[myid] = sendcount[myid];
+    for(int shift = 1; shift < numproc; shift++) {
+      int recvid = (myid + shift) % numproc;
+      int sendid = (myid - shift + numproc) % numproc;
+      sendrecv(&sendcount[recvid], 1, recvid, &recvcount[sendid], 1, sendid);
+    }
+    recvlist[myid] = sendlist[myid];
+    for(int shift = 1; shift < numproc; shift++) {
+      int recvid = (myid + shift) % numproc;
+      int sendid = (myid - shift + numproc) % numproc;
+      recvlist[sendid].resize(recvcount[sendid]);
+      sendrecv(sendlist[recvid].data(), sendcount[recvid], recvid, recvlist[sendid].data(), recvcount[sendid], sendid);
+    }
+#else
+    std::vector<int> sendcount(numproc);
+    std::vector<int> recvcount(numproc);
+    for(int p = 0; p < numproc; p++)
+      sendcount[p] = sendlist[p].size() * sizeof(T);
+    MPI_Alltoall(sendcount.data(), 1, MPI_INT, recvcount.data(), 1, MPI_INT, comm_mpi);
+    std::vector<int> senddispl(numproc + 1, 0);
+    std::vector<int> recvdispl(numproc + 1, 0);
+    for(int p = 0; p < numproc; p++) {
+      senddispl[p + 1] = senddispl[p] + sendcount[p];
+      recvdispl[p + 1] = recvdispl[p] + recvcount[p];
+    }
+    std::vector<char> sendbuf(senddispl[numproc]);
+    std::vector<char> recvbuf(recvdispl[numproc]);
+    for(int p = 0; p < numproc; p++)
+      memcpy(sendbuf.data() + senddispl[p], sendlist[p].data(), sendcount[p]);
+    MPI_Alltoallv(sendbuf.data(), sendcount.data(), senddispl.data(), MPI_BYTE, recvbuf.data(), recvcount.data(), recvdispl.data(), MPI_BYTE, comm_mpi);
+    for(int p = 0; p < numproc; p++) {
+      recvlist[p].resize(recvcount[p] / sizeof(T));
+      memcpy(recvlist[p].data(), recvbuf.data() + recvdispl[p], recvcount[p]);
+    }
+#endif
   }
 
   // MEASUREMENT
+#include "timer.h"
+#include "histogram.h"
+#ifndef COMMBENCH_SORTED_ITER
+#define COMMBENCH_SORTED_ITER 1000 // largest number of iterations for printing the sorted list
+#endif
+#ifndef COMMBENCH_DENSE_REPORT
+#define COMMBENCH_DENSE_REPORT 64 // largest number of processes for printing the dense matrix
+#endif
+  // PER-PROCESS BREAKDOWN
+  // each process accumulates its own start and wait durations and counts the iterations where it was the slowest
+  struct breakdown_t {
+
+    struct record_t {
+      int proc;
+      int numiter;
+      int slowest;
+      double start_sum;
+      double wait_sum;
+      double wait_max;
+      size_t sendbytes;
+      size_t recvbytes;
+      char host[64];
+    };
+
+    int numiter = 0;
+    int slowest = 0;
+    double start_sum = 0;
+    double wait_sum = 0;
+    double wait_max = 0;
+
+    void add(double start, double wait, bool slow) {
+      numiter++;
+      if(slow)
+        slowest++;
+      start_sum += start;
+      wait_sum += wait;
+      if(wait > wait_max)
+        wait_max = wait;
+    }
+
+    // GATHER AND REPORT (COLLECTIVE)
+    void report(size_t sendbytes, size_t recvbytes) {
+      std::vector<record_t> local(1);
+      local[0] = {myid, numiter, slowest, start_sum, wait_sum, wait_max, sendbytes, recvbytes, {0}};
+      gethostname(local[0].host, sizeof(local[0].host) - 1);
+      std::vector<record_t> records;
+      int root = printid < 0 ? 0 : printid;
+      gather(local, records, root);
+      if(myid != root || printid < 0)
+        return;
+      // RANK PROCESSES BY THEIR CONTRIBUTION TO THE MAX, THEN BY THEIR AVERAGE TIME
+      std::stable_sort(records.begin(), records.end(), [](const record_t &a, const record_t &b) -> bool {
+        return a.slowest != b.slowest ? a.slowest > b.slowest : a.start_sum + a.wait_sum > b.start_sum + b.wait_sum;
+      });
+      std::vector<double> avgtime;
+      for(record_t &r : records)
+        avgtime.push_back((r.start_sum + r.wait_sum) / r.numiter);
+      std::vector<double> sorted(avgtime);
+      std::sort(sorted.begin(), sorted.end());
+      double medtime = sorted[sorted.size() / 2];
+      printf("per-process breakdown over %d iterations (slowest first):\n", numiter);
+      printf("proc host slowest avgStart(us) avgWait(us) maxWait(us) send recv injection(GB/s)\n");
+      for(size_t i = 0; i < records.size(); i++) {
+        record_t &r = records[i];
+        if(i == COMMBENCH_DENSE_REPORT) {
+          printf("... %zu more processes\n", records.size() - i);
+          break;
+        }
+        printf("%d %s %d %.4e %.4e %.4e ", r.proc, r.host, r.slowest, r.start_sum / r.numiter * 1e6, r.wait_sum / r.numiter * 1e6, r.wait_max * 1e6);
+        print_data(r.sendbytes); printf(" ");
+        print_data(r.recvbytes); printf(" ");
+        printf("%.4e", avgtime[i] > 0 ? r.sendbytes / avgtime[i] / 1e9 : 0);
+        // CONSISTENT STRAGGLER: SLOWEST IN MOST ITERATIONS AND NOTICEABLY SLOWER THAN THE MEDIAN PROCESS
+        if(numproc > 1 && 2 * r.slowest > r.numiter && avgtime[i] > 1.1 * medtime)
+          printf(" <- straggler");
+        printf("\n");
+      }
+      // AGGREGATE PER NODE
+      std::vector<std::string> hosts;
+      std::vector<int> host_slowest;
+      std::vector<int> host_numproc;
+      for(record_t &r : records) {
+        int h = std::find(hosts.begin(), hosts.end(), std::string(r.host)) - hosts.begin();
+        if(h == (int)hosts.size()) {
+          hosts.push_back(r.host);
+          host_slowest.push_back(0);
+          host_numproc.push_back(0);
+        }
+        host_slowest[h] += r.slowest;
+        host_numproc[h]++;
+      }
+      std::vector<int> order(hosts.size());
+      for(size_t h = 0; h < hosts.size(); h++)
+        order[h] = h;
+      std::stable_sort(order.begin(), order.end(), [&](const int &a, const int &b) -> bool {return host_slowest[a] > host_slowest[b];});
+      printf("per-node breakdown (slowest first):\n");
+      for(int h : order)
+        printf("%s numproc %d slowest %d (%.1f%% of iterations)\n", hosts[h].c_str(), host_numproc[h], host_slowest[h], 100.0 * host_slowest[h] / numiter);
+      printf("\n");
+    }
+  };
+
+  // CLOCK SYNCHRONIZATION
+  // local clocks are modeled as local = global + clock_offset + clock_drift * (local - clock_ref), where global is the clock of process 0
+  static bool syncstart = false; // start iterations at an agreed global timestamp instead of a barrier
+  static bool clock_synced = false;
+  static double clock_offset = 0;
+  static double clock_drift = 0;
+  static double clock_ref = 0;
+  static double clock_slack = 0; // lead time given to all processes before an agreed start
+  static double global_time(double local) {
+    return local - clock_offset - clock_drift * (local - clock_ref);
+  }
+  inline double local_time(double global) {
+    return (global + clock_offset - clock_drift * clock_ref) / (1 - clock_drift);
+  }
+  // SPIN UNTIL THE GLOBAL TIMESTAMP, RETURNS FALSE IF IT HAS ALREADY PASSED
+  static bool wait_until(double global) {
+    if(global_time(wtime()) > global)
+      return false;
+    while(global_time(wtime()) < global);
+    return true;
+  }
+
+  // PING-PONG WITH PROCESS 0 IN TWO ROUNDS SEPARATED BY window SECONDS
+  // THE PING WITH THE SMALLEST ROUND TRIP GIVES THE OFFSET OF A ROUND, THE TWO ROUNDS GIVE THE DRIFT
+  static void sync_clocks(int numping, double window) {
+    const int root = 0;
+    double offset[2] = {0, 0};
+    double mid[2] = {0, 0};
+    double rtt = 0;
+    clock_offset = 0;
+    clock_drift = 0;
+    clock_ref = 0;
+    for(int round = 0; round < 2; round++) {
+      barrier();
+      if(round == 1) {
+        double time = wtime();
+        while(wtime() - time < window);
+        barrier();
+      }
+      for(int p = 0; p < numproc; p++) {
+        if(p == root)
+          continue;
+        double best = HUGE_VAL;
+        for(int ping = 0; ping < numping; ping++) {
+          if(myid == p) {
+            double t_send = wtime();
+            double t_root;
+            send(&t_send, root);
+            recv(&t_root, root);
+            double t_recv = wtime();
+            if(t_recv - t_send < best) {
+              best = t_recv - t_send;
+              mid[round] = (t_send + t_recv) / 2;
+              offset[round] = mid[round] - t_root;
+            }
+          }
+          if(myid == root) {
+            double t_root;
+            recv(&t_root, p);
+            t_root = wtime();
+            send(&t_root, p);
+          }
+        }
+        if(myid == p)
+          rtt = best;
+      }
+    }
+    if(myid != root) {
+      clock_ref = mid[1];
+      clock_offset = offset[1];
+      if(mid[1] > mid[0])
+        clock_drift = (offset[1] - offset[0]) / (mid[1] - mid[0]);
+    }
+    // LEAD TIME COVERS THE REDUCTION THAT FOLLOWS EACH ITERATION
+    barrier();
+    double time = wtime();
+    for(int i = 0; i < 10; i++) {
+      double dummy = 0;
+      allreduce_max(&dummy);
+    }
+    time = (wtime() - time) / 10;
+    allreduce_max(&time);
+    clock_slack = std::max(4 * time, 1e-5);
+    clock_synced = true;
+    double stats[3] = {fabs(clock_offset), fabs(clock_drift), rtt};
+    allreduce(stats, stats, 3, [](const double &a, const double &b) -> double {return (a > b ? a : b);});
+    if(myid == printid)
+      printf("clock sync: max offset %.4e us, max drift %.4e, max min-RTT %.4e us, slack %.4e us\n", stats[0] * 1e6, stats[1], stats[2] * 1e6, clock_slack * 1e6);
+  }
+  static void sync_clocks() {
+    sync_clocks(20, 0.1);
+  }
+  // OFFSETS AND DRIFTS OF ANOTHER TIMER BACKEND ARE MEANINGLESS: DISCARD THEM, AND SYNCHRONIZE AGAIN WITH syncstart
+  static void clock_reset() {
+    if(!clock_synced)
+      return;
+    clock_synced = false;
+    clock_offset = 0;
+    clock_drift = 0;
+    clock_ref = 0;
+    if(syncstart)
+      sync_clocks();
+  }
+
+  // COLD CACHE
+  // before each iteration of a cold pass, a scrub buffer several times the last-level cache is rewritten outside the timed region
+  static bool coldcache = false; // measure each pattern with hot and cold caches side by side
+  static bool scrubbing = false; // set by the cold pass
+  static char *scrub = nullptr; // SCRUB BUFFER, FREED IN finalize()
+  static size_t scrub_size = 0;
+  static size_t cache_size() {
+    long size = 0;
+#ifdef PORT_CUDA
+    int l2;
+    cudaDeviceGetAttribute(&l2, cudaDevAttrL2CacheSize, mydevice);
+    size = l2;
+#elif defined PORT_HIP
+    int l2;
+    hipDeviceGetAttribute(&l2, hipDeviceAttributeL2CacheSize, mydevice);
+    size = l2;
+#elif defined PORT_ONEAPI
+    size = q.get_device().get_info<sycl::info::device::global_mem_cache_size>();
+#else
+#ifdef _SC_LEVEL3_CACHE_SIZE
+    size = sysconf(_SC_LEVEL3_CACHE_SIZE);
+    if(size <= 0)
+      size = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+#endif
+    return size > 0 ? size : (64 << 20); // ASSUME 64 MB WHEN UNKNOWN
+  }
+  // COLLECTIVE AT FIRST CALL
+  static void flush_cache() {
+    if(!scrub) {
+      scrub_size = 4 * cache_size();
+#if !defined PORT_CUDA && !defined PORT_HIP && !defined PORT_ONEAPI
+      // THE PROCESSES OF A NODE SHARE ITS LAST-LEVEL CACHE AND SCRUB IT TOGETHER (A DEVICE CACHE BELONGS TO ONE PROCESS)
+      int numlocal = 1;
+#ifdef USE_MPI
+      MPI_Comm comm_local;
+      MPI_Comm_split_type(comm_mpi, MPI_COMM_TYPE_SHARED, myid, MPI_INFO_NULL, &comm_local);
+      MPI_Comm_size(comm_local, &numlocal);
+      MPI_Comm_free(&comm_local);
+#else
+      gex_Rank_t nbrhd_size;
+      gex_System_QueryNbrhdInfo(nullptr, &nbrhd_size, nullptr);
+      numlocal = nbrhd_size;
+#endif
+      scrub_size = std::max(scrub_size / numlocal, (size_t)64);
+#endif
+#ifdef PORT_CUDA
+      cudaMalloc((void**)&scrub, scrub_size);
+#elif defined PORT_HIP
+      hipMalloc((void**)&scrub, scrub_size);
+#elif defined PORT_ONEAPI
+      scrub = sycl::malloc_device<char>(scrub_size, q);
+#else
+      scrub = new char[scrub_size]();
+#endif
+      if(myid == printid) {
+        printf("cache scrub buffer: "); print_data(scrub_size); printf(" per process\n");
+      }
+    }
+#ifdef PORT_CUDA
+    cudaMemset(scrub, -1, scrub_size);
+    cudaDeviceSynchronize();
+#elif defined PORT_HIP
+    hipMemset(scrub, -1, scrub_size);
+    hipDeviceSynchronize();
+#elif defined PORT_ONEAPI
+    q.memset(scrub, -1, scrub_size).wait();
+#else
+    // READ-MODIFY-WRITE EVERY LINE, A PLAIN MEMSET MAY BYPASS THE CACHE WITH STREAMING STORES
+    volatile char *line = scrub;
+    for(size_t i = 0; i < scrub_size; i += 64)
+      line[i]++;
+#endif
+  }
+
+  // SYNTHETIC WORKLOAD
+  // host kernels that keep the CPU busy between start() and wait(), n is the amount of work in calibrated units
+  static double workload_sink = 0; // KEEPS THE RESULTS ALIVE
+  // COMPUTE-BOUND: INDEPENDENT MULTIPLY-ADD CHAINS IN REGISTERS
+  inline void workload_compute(size_t n) {
+    double acc[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    for(size_t i = 0; i < n; i++)
+      for(int j = 0; j < 8; j++)
+        acc[j] = acc[j] * 0.999999999 + 1e-9;
+    for(int j = 0; j < 8; j++)
+      workload_sink += acc[j];
+  }
+  // MEMORY-BOUND: READ-MODIFY-WRITE STREAM THAT RESUMES WHERE THE LAST CALL LEFT OFF IN A BUFFER LARGER THAN THE CACHE
+  inline void workload_memory(size_t n) {
+    static std::vector<double> buffer;
+    static size_t pos = 0;
+    if(buffer.empty())
+      buffer.resize(4 * cache_size() / sizeof(double), 1);
+    while(n) {
+      size_t count = std::min(n, buffer.size() - pos);
+      double *ptr = buffer.data() + pos;
+      for(size_t i = 0; i < count; i++)
+        ptr[i] = ptr[i] * 0.5 + 1;
+      pos = (pos + count) % buffer.size();
+      n -= count;
+    }
+  }
+  // AMOUNT OF WORK THAT TAKES target SECONDS, EXTRAPOLATED FROM A RUN OF AT LEAST A MILLISECOND
+  static size_t workload_calibrate(void (*kernel)(size_t), double target) {
+    size_t n = 1024;
+    double time = 0;
+    while(true) {
+      kernel(n); // WARMUP
+      time = wtime();
+      kernel(n);
+      time = wtime() - time;
+      if(time > 1e-3)
+        break;
+      n *= 2;
+    }
+    return std::max((size_t)1, (size_t)(n * target / time));
+  }
+
+#include "trace.h"
+#include "results.h"
+
+  template <typename C>
+  static void measure(int warmup, int numiter, histogram_t &hist, C &comm, std::vector<double> *iters = nullptr);
   template <typename C>
   static void measure(int warmup, int numiter, double &minTime, double &medTime, double &maxTime, double &avgTime, C &comm);
+  template <typename C>
+  static void measure_adaptive(double precision, double budget, histogram_t &hist, C &comm);
 
   template <typename T>
   struct pyalloc {
@@ -323,6 +864,9 @@ namespace CommBench
     // grab a single GPU
     setup_gpu();
 
+    // calibrate the timer
+    set_timer(timer);
+
 #ifdef CAP_GASNET
     {
 #if defined(PORT_CUDA) || defined(PORT_HIP) || defined(PORT_ONEAPI)
@@ -353,7 +897,29 @@ namespace CommBench
     static bool finalize = false;
     if(finalize) return;
     finalize = true;
+    trace_dump();
+    results_finalize();
+    if(scrub) {
+#ifdef PORT_CUDA
+      cudaFree(scrub);
+#elif defined PORT_HIP
+      hipFree(scrub);
+#elif defined PORT_ONEAPI
+      sycl::free(scrub, q);
+#else
+      delete[] scrub;
+#endif
+      scrub = nullptr;
+    }
 #ifdef USE_MPI
+    if(win_rma != MPI_WIN_NULL) {
+      MPI_Win_unlock_all(win_rma);
+      for(auto &region : rma_region)
+        MPI_Win_detach(win_rma, region.first);
+      MPI_Win_free(&win_rma);
+      rma_region.clear();
+      rma_attached.clear();
+    }
     int finalize_mpi;
     MPI_Finalized(&finalize_mpi);
     if (!finalize_mpi) {
@@ -367,84 +933,373 @@ namespace CommBench
 #endif
   }
 
+#ifdef USE_MPI
+  // ONE-SIDED MPI
+  // a single dynamic window is created at the first MPI_put / MPI_get bench and stays in a passive-target epoch (lock_all) until finalize()
+  // registered buffers are attached once; overlapping regions are merged because attached regions must be disjoint
+  // a buffer is detached when the last communicator that attached it is released; the rest of its region stays attached
+  static void rma_window() {
+    if(win_rma != MPI_WIN_NULL)
+      return;
+    MPI_Win_create_dynamic(MPI_INFO_NULL, comm_mpi, &win_rma);
+    MPI_Win_lock_all(MPI_MODE_NOCHECK, win_rma);
+    if(myid == printid)
+      printf("******************** MPI DYNAMIC WINDOW IS CREATED\n");
+  }
+  static void rma_merge(char *begin, char *end) {
+    for(auto it = rma_region.begin(); it != rma_region.end();) {
+      if(it->first <= begin && end <= it->second)
+        return; // ALREADY ATTACHED
+      if(it->first <= end && begin <= it->second) {
+        begin = std::min(begin, it->first);
+        end = std::max(end, it->second);
+        MPI_Win_detach(win_rma, it->first);
+        it = rma_region.erase(it);
+      }
+      else
+        it++;
+    }
+    MPI_Win_attach(win_rma, begin, end - begin);
+    rma_region.push_back({begin, end});
+  }
+  // RETURNS THE ADDRESS OF ptr THAT IS USED AS A TARGET DISPLACEMENT BY THE OTHER PROCESSES
+  static MPI_Aint rma_attach(void *ptr, size_t bytes) {
+    char *begin = (char*)ptr;
+    char *end = begin + std::max(bytes, (size_t)1);
+    rma_attached.push_back({begin, end});
+    rma_merge(begin, end);
+    MPI_Aint disp;
+    MPI_Get_address(ptr, &disp);
+    return disp;
+  }
+  // LOCAL: THE OTHER PROCESSES MUST BE DONE WITH ptr
+  inline void rma_detach(void *ptr, size_t bytes) {
+    char *begin = (char*)ptr;
+    char *end = begin + std::max(bytes, (size_t)1);
+    auto it = std::find(rma_attached.begin(), rma_attached.end(), std::make_pair(begin, end));
+    if(it == rma_attached.end())
+      return;
+    rma_attached.erase(it);
+    for(auto region = rma_region.begin(); region != rma_region.end(); region++)
+      if(region->first <= begin && end <= region->second) {
+        std::pair<char*, char*> detached = *region;
+        MPI_Win_detach(win_rma, detached.first);
+        rma_region.erase(region);
+        // RE-ATTACH WHAT IS STILL IN USE
+        for(auto &attached : rma_attached)
+          if(detached.first <= attached.first && attached.second <= detached.second)
+            rma_merge(attached.first, attached.second);
+        return;
+      }
+  }
+#endif
+
+  // NODE-WIDE SHARED MEMORY
+  // with sharedmemory, allocate() on the CPU port is collective: each process allocates its buffer with MPI_Win_allocate_shared
+  // and maps the buffers of all processes in the same node. at registration, the owner of a buffer sends its address, which the peer
+  // resolves in these mappings, so that IPC copies it with a direct memcpy and no handle is exchanged
+  struct shared_t {
+#ifdef USE_MPI
+    MPI_Win win;
+#endif
+    std::vector<char*> view; // MAPPING OF EACH PROCESS' BUFFER IN THIS PROCESS, nullptr FOR OTHER NODES
+    std::vector<char*> base; // ADDRESS OF EACH PROCESS' BUFFER IN ITS OWN ADDRESS SPACE
+    std::vector<size_t> bytes;
+  };
+  static std::vector<shared_t> shared_segment;
+#ifdef USE_MPI
+  static MPI_Comm comm_node = MPI_COMM_NULL;
+#endif
+  size_t memory_shared = 0;
+
+  template <typename T>
+  void allocateShared(T *&buffer, size_t n) {
+#ifdef USE_MPI
+    if(comm_node == MPI_COMM_NULL)
+      MPI_Comm_split_type(comm_mpi, MPI_COMM_TYPE_SHARED, myid, MPI_INFO_NULL, &comm_node);
+    int numlocal;
+    MPI_Comm_size(comm_node, &numlocal);
+    shared_t segment;
+    segment.view.resize(numproc, nullptr);
+    segment.base.resize(numproc, nullptr);
+    segment.bytes.resize(numproc, 0);
+    // EACH BUFFER IS PLACED IN ITS OWN PAGES, CLOSE TO ITS OWNER
+    MPI_Info info;
+    MPI_Info_create(&info);
+    MPI_Info_set(info, "alloc_shared_noncontig", "true");
+    char *ptr;
+    MPI_Win_allocate_shared(n * sizeof(T), sizeof(T), info, comm_node, &ptr, &segment.win);
+    MPI_Info_free(&info);
+    // WORLD RANK AND OWN ADDRESS OF EACH PROCESS IN THE NODE
+    std::vector<int> rank(numlocal);
+    std::vector<char*> base(numlocal);
+    MPI_Allgather(&myid, 1, MPI_INT, rank.data(), 1, MPI_INT, comm_node);
+    MPI_Allgather(&ptr, sizeof(char*), MPI_BYTE, base.data(), sizeof(char*), MPI_BYTE, comm_node);
+    for(int local = 0; local < numlocal; local++) {
+      MPI_Aint bytes;
+      int disp_unit;
+      MPI_Win_shared_query(segment.win, local, &bytes, &disp_unit, &segment.view[rank[local]]);
+      segment.base[rank[local]] = base[local];
+      segment.bytes[rank[local]] = bytes;
+    }
+    shared_segment.push_back(segment);
+    buffer = (T*)ptr;
+#else
+    allocateHost(buffer, n);
+#endif
+  }
+
+  // FREES A SHARED BUFFER (COLLECTIVE), RETURNS FALSE IF THE BUFFER IS NOT SHARED
+  static bool free_shared(void *buffer) {
+#ifdef USE_MPI
+    for(auto it = shared_segment.begin(); it != shared_segment.end(); it++)
+      if(it->view[myid] == buffer) {
+        MPI_Win_free(&it->win);
+        shared_segment.erase(it);
+        return true;
+      }
+#endif
+    return false;
+  }
+
+  // MAPPING OF ptr IN THE ADDRESS SPACE OF proc, nullptr IF NOT SHARED
+  inline char *shared_translate(void *ptr, int proc) {
+    for(shared_t &segment : shared_segment)
+      if(segment.view[proc] && (char*)ptr >= segment.base[proc] && (char*)ptr < segment.base[proc] + segment.bytes[proc])
+        return segment.view[proc] + ((char*)ptr - segment.base[proc]);
+    return nullptr;
+  }
+
+  // CROSS MEMORY ATTACH
+  // A PROCESS ID ONLY MEANS SOMETHING ON ITS OWN NODE: CPU IPC HANDLES CARRY A HASH OF THE HOSTNAME AND THE BOOT ID
+  uint64_t node_identity() {
+    static uint64_t identity = 0;
+    if(identity)
+      return identity;
+    char text[128] = {0};
+    gethostname(text, 63);
+    FILE *file = fopen("/proc/sys/kernel/random/boot_id", "r");
+    if(file) {
+      if(fgets(text + 64, 64, file) == nullptr)
+        text[64] = 0;
+      fclose(file);
+    }
+    identity = 14695981039346656037ull; // FNV-1A
+    for(char c : text)
+      identity = (identity ^ (unsigned char)c) * 1099511628211ull;
+    return identity;
+  }
+
+#include "copy.h"
+#include "pattern.h"
+#include "model.h"
 #include "comm.h"
   // THIS IS TO INITIALIZE COMMBENCH
   // static Comm<char> init(dummy);
 
-  static void print_stats(std::vector<double> times, size_t data) {
+  static void print_stats(histogram_t &hist, std::vector<double> times, size_t data) {
 
     std::sort(times.begin(), times.end(),  [](const double & a, const double & b) -> bool {return a < b;});
 
     int numiter = times.size();
 
     if(myid == printid) {
-      printf("%d measurement iterations (sorted):\n", numiter);
-      for(int iter = 0; iter < numiter; iter++) {
-        printf("time: %.4e", times[iter] * 1e6);
-        if(iter == 0)
-          printf(" -> min\n");
-        else if(iter == numiter / 2)
-          printf(" -> median\n");
-        else if(iter == numiter - 1)
-          printf(" -> max\n");
-        else
-          printf("\n");
+      if(numiter) {
+        printf("%d measurement iterations (sorted):\n", numiter);
+        for(int iter = 0; iter < numiter; iter++) {
+          printf("time: %.4e", times[iter] * 1e6);
+          if(iter == 0)
+            printf(" -> min\n");
+          else if(iter == numiter / 2)
+            printf(" -> median\n");
+          else if(iter == numiter - 1)
+            printf(" -> max\n");
+          else
+            printf("\n");
+        }
       }
+      else
+        printf("%lu measurement iterations\n", hist.count);
       printf("\n");
     }
-    double minTime = times[0];
-    double medTime = times[numiter / 2];
-    double maxTime = times[numiter - 1];
-    double avgTime = 0;
-    for(int iter = 0; iter < numiter; iter++)
-      avgTime += times[iter];
-    avgTime /= numiter;
-    if(myid == printid) {
-      printf("data: "); print_data(data); printf("\n");
-      printf("minTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", minTime * 1e6, minTime / data * 1e12, data / minTime / 1e9);
-      printf("medTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", medTime * 1e6, medTime / data * 1e12, data / medTime / 1e9);
-      printf("maxTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", maxTime * 1e6, maxTime / data * 1e12, data / maxTime / 1e9);
-      printf("avgTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", avgTime * 1e6, avgTime / data * 1e12, data / avgTime / 1e9);
-      printf("\n");
-    }
+    hist.print(data);
+  }
+  static void print_stats(std::vector<double> times, size_t data) {
+    histogram_t hist;
+    for(double time : times)
+      hist.add(time);
+    print_stats(hist, times.size() <= COMMBENCH_SORTED_ITER ? times : std::vector<double>(), data);
   }
 
   template <typename T>
   static void measure_async(std::vector<Comm<T>> commlist, int warmup, int numiter, size_t count) {
+    histogram_t hist;
+    breakdown_t breakdown;
     std::vector<double> t;
     for(int iter = -warmup; iter < numiter; iter++) {
       barrier();
-      double time = omp_get_wtime();
+      trace("iteration", 'B', -1, iter);
+      double time = wtime();
       for (auto &i : commlist) {
         i.start();
         i.wait();
       }
-      time = omp_get_wtime() - time;
+      time = timer_correct(wtime() - time);
+      trace("iteration", 'E', -1, iter);
+      double mytime = time;
       allreduce_max(&time);
-      if(iter >= 0)
-        t.push_back(time);
+      if(iter >= 0) {
+        hist.add(time);
+        breakdown.add(0, mytime, mytime == time);
+        if(numiter <= COMMBENCH_SORTED_ITER || results_file)
+          t.push_back(time);
+      }
+    }
+    print_stats(hist, numiter <= COMMBENCH_SORTED_ITER ? t : std::vector<double>(), count * sizeof(T));
+    size_t sendbytes = 0;
+    size_t recvbytes = 0;
+    int numcomm = 0;
+    for(auto &i : commlist) {
+      for(int send = 0; send < i.numsend; send++)
+        sendbytes += i.sendcount[send] * sizeof(T);
+      for(int recv = 0; recv < i.numrecv; recv++)
+        recvbytes += i.recvcount[recv] * sizeof(T);
+      numcomm += i.numcomm;
     }
-    print_stats(t, count * sizeof(T));
+    if(perrank)
+      breakdown.report(sendbytes, recvbytes);
+    results_record("async", -1, commlist.size() ? lib_name(commlist[0].lib) : "dummy", numcomm, count, count * sizeof(T), sendbytes, recvbytes, hist, t);
   }
 
   template <typename T>
   static void measure_concur(std::vector<Comm<T>> commlist, int warmup, int numiter, size_t count) {
+    histogram_t hist;
+    breakdown_t breakdown;
     std::vector<double> t;
     for(int iter = -warmup; iter < numiter; iter++) {
       barrier();
-      double time = omp_get_wtime();
+      trace("iteration", 'B', -1, iter);
+      double time = wtime();
       for (auto &i : commlist) {
         i.start();
       }
       for (auto &i : commlist) {      
         i.wait();
       }
-      time = omp_get_wtime() - time;
+      time = timer_correct(wtime() - time);
+      trace("iteration", 'E', -1, iter);
+      double mytime = time;
       allreduce_max(&time);
-      if(iter >= 0)
-        t.push_back(time);
+      if(iter >= 0) {
+        hist.add(time);
+        breakdown.add(0, mytime, mytime == time);
+        if(numiter <= COMMBENCH_SORTED_ITER || results_file)
+          t.push_back(time);
+      }
+    }
+    print_stats(hist, numiter <= COMMBENCH_SORTED_ITER ? t : std::vector<double>(), count * sizeof(T));
+    size_t sendbytes = 0;
+    size_t recvbytes = 0;
+    int numcomm = 0;
+    for(auto &i : commlist) {
+      for(int send = 0; send < i.numsend; send++)
+        sendbytes += i.sendcount[send] * sizeof(T);
+      for(int recv = 0; recv < i.numrecv; recv++)
+        recvbytes += i.recvcount[recv] * sizeof(T);
+      numcomm += i.numcomm;
+    }
+    if(perrank)
+      breakdown.report(sendbytes, recvbytes);
+    results_record("concur", -1, commlist.size() ? lib_name(commlist[0].lib) : "dummy", numcomm, count, count * sizeof(T), sendbytes, recvbytes, hist, t);
+  }
+
+  // FIT THE MODEL OF A LIBRARY WITH A SINGLE PAIR OF EACH LINK CLASS, FROM PROCESS 0 TO THE NEAREST PROCESS OF THAT CLASS
+  inline void fit_model(model_t &model, library lib, int warmup, int numiter, int numstep, size_t maxbytes) {
+    find_nodes();
+    int pair[numlink] = {0, -1, -1};
+    for(int p = numproc - 1; p > 0; p--)
+      pair[link_of(0, p)] = p;
+    char *sendbuf;
+    char *recvbuf;
+    allocate(sendbuf, maxbytes);
+    allocate(recvbuf, maxbytes);
+    for(int link = 0; link < numlink; link++) {
+      if(pair[link] < 0) {
+        if(myid == printid)
+          printf("no %s pair to fit\n", link_name(link));
+        continue;
+      }
+      Comm<char> comm(lib);
+      comm.add(sendbuf, 0, recvbuf, 0, maxbytes, 0, pair[link]);
+      comm.fit(model, warmup, numiter, numstep);
     }
-    print_stats(t, count * sizeof(T));
+    free(sendbuf);
+    free(recvbuf);
+  }
+
+  // ANALYTICAL TIME OF A SEQUENCE OF STEPS (E.G., STRIPING OR HIERARCHICAL DECOMPOSITIONS) AS MEASURED WITH measure_async
+  template <typename T>
+  static double predict(std::vector<Comm<T>> &commlist, model_t &model) {
+    double time = 0;
+    for(auto &i : commlist)
+      time += i.predict(model);
+    if(myid == printid)
+      printf("predicted end-to-end time of %zu steps: %.4e us\n\n", commlist.size(), time * 1e6);
+    return time;
+  }
+
+#include "graph.h"
+
+  // PIPELINED SEQUENCE: EVERY MESSAGE OF EVERY STAGE IS CUT INTO numchunk CHUNKS, AND CHUNK k OF A STAGE DEPENDS ON CHUNK k OF THE PREVIOUS STAGE
+  // SO THAT CHUNK k OF STAGE s + 1 OVERLAPS WITH CHUNK k + 1 OF STAGE s (ASSUMES THAT EACH STAGE FORWARDS WHOLE MESSAGES OF THE PREVIOUS)
+  // WITH MPI, THE CHUNKS DEPEND ON ALL CHUNKS OF THE PREVIOUS STAGE AND THE ACTUAL DEPENDENCIES ARE FOUND PER BUFFER
+  template <typename T>
+  static double measure_pipeline(std::vector<Comm<T>> &sequence, int numchunk, int warmup, int numiter, size_t count) {
+    int printid_temp = printid;
+    printid = -1;
+    bool mpi = true;
+    for(auto &stage : sequence)
+      if(stage.lib != MPI)
+        mpi = false;
+    std::list<Comm<T>> chunklist;
+    std::vector<std::vector<int>> step(sequence.size());
+    Graph<T> graph;
+    for(size_t s = 0; s < sequence.size(); s++) {
+      Comm<T> &stage = sequence[s];
+      for(int k = 0; k < numchunk; k++) {
+        chunklist.emplace_back(stage.lib);
+        Comm<T> &chunk = chunklist.back();
+        for(int send = 0; send < stage.numsend; send++) {
+          size_t lo = stage.sendcount[send] * k / numchunk;
+          size_t hi = stage.sendcount[send] * (k + 1) / numchunk;
+          chunk.add_send(stage.sendbuf[send], stage.sendoffset[send] + lo, hi - lo, stage.sendproc[send]);
+        }
+        for(int recv = 0; recv < stage.numrecv; recv++) {
+          size_t lo = stage.recvcount[recv] * k / numchunk;
+          size_t hi = stage.recvcount[recv] * (k + 1) / numchunk;
+          chunk.add_recv(stage.recvbuf[recv], stage.recvoffset[recv] + lo, hi - lo, stage.recvproc[recv]);
+        }
+        chunk.commit();
+        std::vector<int> depend;
+        if(s > 0) {
+          if(mpi)
+            depend = step[s - 1];
+          else
+            depend.push_back(step[s - 1][k]);
+        }
+        step[s].push_back(graph.add(chunk, depend));
+      }
+    }
+    graph.commit();
+    printid = printid_temp;
+    if(myid == printid)
+      printf("pipeline of %zu stages in %d chunks\n", sequence.size(), numchunk);
+    histogram_t hist;
+    graph.measure(warmup, numiter, count, hist, "pipeline");
+    double median = hist.percentile(0.5);
+    if(myid == printid)
+      printf("pipeline of %zu stages in %d chunks: end-to-end %.4e us, %.4e GB/s (median)\n\n", sequence.size(), numchunk, median * 1e6, count * sizeof(T) / median / 1e9);
+    return median;
   }
 
 #ifdef USE_MPI
@@ -479,9 +1334,9 @@ namespace CommBench
     std::vector<double> t;
     for(int iter = -warmup; iter < numiter; iter++) {
       barrier();
-      double time = omp_get_wtime();
+      double time = wtime();
       MPI_Alltoallv(sendbuf, &sendcount[0], &senddispl[0], MPI_BYTE, recvbuf, &recvcount[0], &recvdispl[0], MPI_BYTE, comm_mpi);
-      time = omp_get_wtime() - time;
+      time = timer_correct(wtime() - time);
       allreduce_max(&time);
       if(iter >= 0)
         t.push_back(time);
@@ -492,91 +1347,254 @@ namespace CommBench
     int data;
     allreduce_sum(&senddispl[numproc], &data);
     print_stats(t, data * sizeof(T));
+    if(results_file) {
+      histogram_t hist;
+      for(double time : t)
+        hist.add(time);
+      int numcomm = 0;
+      for(auto &row : pattern)
+        for(int count : row)
+          numcomm += (count > 0);
+      results_record("MPI_Alltoallv", -1, "MPI", numcomm, data, data * sizeof(T), senddispl[numproc] * sizeof(T), recvdispl[numproc] * sizeof(T), hist, t);
+    }
   }
 #endif
 
   template <typename C>
-  static void measure(int warmup, int numiter, double &minTime, double &medTime, double &maxTime, double &avgTime, C &comm) {
+  static void measure(int warmup, int numiter, histogram_t &hist, C &comm, std::vector<double> *iters) {
+
+    // ITERATIONS ARE KEPT FOR PRINTING THE SORTED LIST, AND FOR THE RESULTS SINK WHEN iters IS GIVEN (ONLY WITH AN OPEN RESULTS FILE)
+    bool sorted = numiter <= COMMBENCH_SORTED_ITER;
+    std::vector<double> times;
+    std::vector<double> starts;
 
-    double times[numiter];
-    double starts[numiter];
+    breakdown_t breakdown;
+
+    // SYNCHRONIZED START: THE NEXT ITERATION BEGINS clock_slack AFTER THE LAST COMPLETION OF THE PREVIOUS
+    if(syncstart && !clock_synced)
+      sync_clocks();
+    double target = 0;
+    int late = 0;
+    // THE FLUSH BETWEEN COLD ITERATIONS IS ADDED TO THE LEAD TIME
+    double lead = clock_slack;
+    if(syncstart && scrubbing) {
+      barrier();
+      double time = wtime();
+      flush_cache();
+      time = wtime() - time;
+      allreduce_max(&time);
+      lead += time;
+    }
+    if(syncstart) {
+      target = global_time(wtime()) + lead;
+      broadcast(&target);
+    }
 
     if(myid == printid)
       printf("%d warmup iterations (in order):\n", warmup);
     for (int iter = -warmup; iter < numiter; iter++) {
-      for(int send = 0; send < comm.numsend; send++) {
-#if defined PORT_CUDA
-        // cudaMemset(sendbuf[send], -1, sendcount[send] * sizeof(T));
-#elif defined PORT_HIP
-        // hipMemset(sendbuf[send], -1, sendcount[send] * sizeof(T));
-#elif defined PORT_ONEAPI
-        // q->memset(sendbuf[send], -1, sendcount[send] * sizeof(T)).wait();
-#else
-        // memset(comm.sendbuf[send], -1, comm.sendcount[send] * sizeof(T)); // NECESSARY FOR CPU TO PREVENT CACHING
-#endif
+      if(scrubbing)
+        flush_cache(); // NECESSARY FOR CPU TO PREVENT CACHING
+      if(syncstart) {
+        if(!wait_until(target) && iter >= 0)
+          late++;
       }
-      barrier();
-      double time = omp_get_wtime();
+      else
+        barrier();
+      trace("iteration", 'B', -1, iter);
+      double time = wtime();
+      double local = time;
       comm.start();
-      double start = omp_get_wtime() - time;
+      double start = wtime() - time;
       comm.wait();
-      time = omp_get_wtime() - time;
-      barrier();
+      time = wtime() - time;
+      trace("iteration", 'E', -1, iter);
+      if(syncstart) {
+        // DURATIONS ARE MEASURED FROM THE AGREED START IN GLOBAL TIME
+        start = global_time(local + start) - target;
+        time = global_time(local + time) - target;
+      }
+      else
+        barrier();
+      start = timer_correct(start);
+      time = timer_correct(time);
+      double mystart = start;
+      double mytime = time;
       allreduce_max(&start);
       allreduce_max(&time);
+      if(syncstart)
+        target += time + lead;
       if(iter < 0) {
         if(myid == printid)
           printf("startup %.2e warmup: %.2e\n", start * 1e6, time * 1e6);
       }
       else {
-        starts[iter] = start;
-        times[iter] = time;
+        hist.add(time);
+        breakdown.add(mystart, mytime - mystart, mytime == time);
+        if(sorted)
+          starts.push_back(start);
+        if(sorted || iters)
+          times.push_back(time);
       }
     }
-    std::sort(times, times + numiter,  [](const double & a, const double & b) -> bool {return a < b;});
-    std::sort(starts, starts + numiter,  [](const double & a, const double & b) -> bool {return a < b;});
+    if(iters)
+      *iters = times;
+    std::sort(times.begin(), times.end(),  [](const double & a, const double & b) -> bool {return a < b;});
+    std::sort(starts.begin(), starts.end(),  [](const double & a, const double & b) -> bool {return a < b;});
 
     if(myid == printid) {
-      printf("%d measurement iterations (sorted):\n", numiter);
-      for(int iter = 0; iter < numiter; iter++) {
-        printf("start: %.4e time: %.4e", starts[iter] * 1e6, times[iter] * 1e6);
-        if(iter == 0)
-          printf(" -> min\n");
-        else if(iter == numiter / 2)
-          printf(" -> median\n");
-        else if(iter == numiter - 1)
-          printf(" -> max\n");
-        else
-          printf("\n");
+      if(sorted) {
+        printf("%d measurement iterations (sorted):\n", numiter);
+        for(int iter = 0; iter < numiter; iter++) {
+          printf("start: %.4e time: %.4e", starts[iter] * 1e6, times[iter] * 1e6);
+          if(iter == 0)
+            printf(" -> min\n");
+          else if(iter == numiter / 2)
+            printf(" -> median\n");
+          else if(iter == numiter - 1)
+            printf(" -> max\n");
+          else
+            printf("\n");
+        }
       }
+      else
+        printf("%d measurement iterations\n", numiter);
       printf("\n");
     }
-    minTime = times[0];
-    medTime = times[numiter / 2];
-    maxTime = times[numiter - 1];
-    avgTime = 0;
-    for(int iter = 0; iter < numiter; iter++)
-      avgTime += times[iter];
-    avgTime /= numiter;
+    if(syncstart) {
+      allreduce_sum(&late);
+      if(myid == printid && late)
+        printf("%d late starts out of %d (increase CommBench::clock_slack)\n\n", late, numiter * numproc);
+    }
+    if(perrank) {
+      size_t sendbytes = 0;
+      size_t recvbytes = 0;
+      for(int send = 0; send < comm.numsend; send++)
+        sendbytes += comm.sendcount[send] * sizeof(typename C::value_type);
+      for(int recv = 0; recv < comm.numrecv; recv++)
+        recvbytes += comm.recvcount[recv] * sizeof(typename C::value_type);
+      breakdown.report(sendbytes, recvbytes);
+    }
+  }
+
+  template <typename C>
+  static void measure(int warmup, int numiter, double &minTime, double &medTime, double &maxTime, double &avgTime, C &comm) {
+    histogram_t hist;
+    measure(warmup, numiter, hist, comm);
+    minTime = hist.min;
+    medTime = hist.percentile(0.5);
+    maxTime = hist.max;
+    avgTime = hist.mean();
+  }
+
+  // ADAPTIVE MEASUREMENT
+  // warmup ends when the medians of two consecutive blocks of iterations agree within precision,
+  // then iterations are repeated until the 95% confidence interval of the median (by order statistics)
+  // is narrower than precision relative to the median, or until budget seconds have passed.
+  // all decisions are made on allreduced values, therefore all processes take the same branches
+  template <typename C>
+  static void measure_adaptive(double precision, double budget, histogram_t &hist, C &comm) {
+
+    const int block = 5;
+    double elapsed = wtime();
+    // THE CONFIDENCE INTERVAL CANNOT BE RESOLVED BELOW THE WIDTH OF A HISTOGRAM BUCKET
+    precision = std::max(precision, 1.0 / (1 << HIST_SUBBITS));
+    auto iteration = [&comm]() -> double {
+      barrier();
+      trace("iteration", 'B', -1, -1);
+      double time = wtime();
+      comm.start();
+      comm.wait();
+      time = timer_correct(wtime() - time);
+      trace("iteration", 'E', -1, -1);
+      allreduce_max(&time);
+      return time;
+    };
+    // ELAPSED TIME OF THE SLOWEST PROCESS
+    auto spent = [&elapsed]() -> double {
+      double time = wtime() - elapsed;
+      allreduce_max(&time);
+      return time;
+    };
+
+    // STEADY-STATE DETECTION
+    int warmup = 0;
+    double median_prev = 0;
+    while(true) {
+      std::vector<double> times(block);
+      for(int i = 0; i < block; i++)
+        times[i] = iteration();
+      warmup += block;
+      std::sort(times.begin(), times.end());
+      double median = times[block / 2];
+      if(median_prev > 0 && fabs(median - median_prev) <= precision * median_prev)
+        break;
+      median_prev = median;
+      // WARMUP MAY TAKE AT MOST A QUARTER OF THE BUDGET
+      if(spent() * 4 > budget) {
+        if(myid == printid)
+          printf("warmup did not reach steady state in %d iterations\n", warmup);
+        break;
+      }
+    }
+
+    // ITERATE UNTIL THE CONFIDENCE INTERVAL IS NARROW ENOUGH
+    double lower = 0;
+    double upper = 0;
+    double median = 0;
+    int check = 10;
+    bool converged = false;
+    while(true) {
+      hist.add(iteration());
+      int numiter = hist.count;
+      if(numiter < check)
+        continue;
+      double halfwidth = 1.96 * sqrt(numiter) / 2;
+      lower = hist.percentile(std::max(floor(numiter / 2.0 - halfwidth), 1.0) / numiter);
+      upper = hist.percentile(std::min(ceil(numiter / 2.0 + halfwidth), (double)numiter) / numiter);
+      median = hist.percentile(0.5);
+      converged = upper - lower <= precision * median;
+      if(converged || spent() > budget)
+        break;
+      check += std::max(10, numiter / 10);
+    }
+    if(myid == printid) {
+      printf("adaptive measurement: %d warmup iterations, %lu measurement iterations in %.2f s\n", warmup, hist.count, wtime() - elapsed);
+      printf("median %.4e us, 95%% confidence interval [%.4e, %.4e] us (%.2f%% of median)%s\n\n", median * 1e6, lower * 1e6, upper * 1e6, (upper - lower) / median * 100, converged ? "" : " -> budget exhausted");
+    }
   }
 
   // MEMORY MANAGEMENT
   size_t memory = 0;
   void report_memory() {
     std::vector<size_t> memory_all(numproc);
+    std::vector<size_t> shared_all(numproc);
     allgather(&memory, memory_all.data());
+    allgather(&memory_shared, shared_all.data());
     if(myid == printid) {
       size_t memory_total = 0;
+      size_t shared_total = 0;
       printf("\n");
       printf("CommBench memory report:\n");
       for(int i = 0; i < numproc; i++) {
         printf("proc: %d memory ", i);
         print_data(memory_all[i]);
+        if(shared_all[i]) {
+          printf(" (node-wide shared ");
+          print_data(shared_all[i]);
+          printf(")");
+        }
         printf("\n");
         memory_total += memory_all[i];
+        shared_total += shared_all[i];
       }
       printf("total memory: ");
       print_data(memory_total);
+      if(shared_total) {
+        printf(" (node-wide shared ");
+        print_data(shared_total);
+        printf(" in %zu segments)", shared_segment.size());
+      }
       printf("\n");
       printf("\n");
     }
@@ -590,6 +1608,7 @@ namespace CommBench
 #endif
   }
 
+  // WITH sharedmemory ON THE CPU PORT, COLLECTIVE OVER THE PROCESSES OF EACH NODE: ALL OF THEM CALL IT IN THE SAME ORDER
   template <typename T>
   void allocate(T *&buffer, size_t n) {
 #ifdef PORT_CUDA
@@ -599,7 +1618,10 @@ namespace CommBench
 #elif defined PORT_ONEAPI
     buffer = sycl::malloc_device<T>(n, CommBench::q);
 #else
-    allocateHost(buffer, n);
+    if(sharedmemory)
+      allocateShared(buffer, n);
+    else
+      allocateHost(buffer, n);
 #endif
 #ifdef CAP_GASNET
     // save ep/segment pair for later publication
@@ -613,6 +1635,10 @@ namespace CommBench
     // gex_EP_PublishBoundSegment(myteam, &myep, 1, 0); // currently works only for symmetric allocation
 #endif
     memory += n * sizeof(T);
+#if !defined PORT_CUDA && !defined PORT_HIP && !defined PORT_ONEAPI
+    if(sharedmemory)
+      memory_shared += n * sizeof(T);
+#endif
   };
 
   template <typename T>
@@ -676,7 +1702,8 @@ namespace CommBench
 #elif defined PORT_ONEAPI
     sycl::free(buffer, CommBench::q);
 #else
-    freeHost(buffer);
+    if(!free_shared(buffer))
+      freeHost(buffer);
 #endif
   }
 
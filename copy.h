@@ -0,0 +1,195 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// COPY ENGINE
+// large host copies (CPU IPC and self communication) are split into cache-sized chunks that are taken by a pool of pinned threads
+// the workers are pinned to the CPUs that the process is allowed to run on, spread round-robin over their NUMA nodes
+// each worker first takes the chunks whose local pages are on its own node (queried with move_pages), then helps the other nodes
+// the calling thread takes part in every copy, so a copy with one thread (the default of Comm) does not involve the pool
+
+#ifndef COMMBENCH_COPY_CHUNK
+#define COMMBENCH_COPY_CHUNK 262144 // bytes per chunk, fits in L2
+#endif
+
+struct copy_engine_t {
+
+  // TOPOLOGY
+  std::vector<int> cpu; // ALLOWED CPUS, ROUND-ROBIN OVER THE NUMA NODES
+  std::vector<int> cpu_node; // NUMA NODE OF EACH CPU
+  int numnode = 0;
+
+  // POOL
+  std::vector<std::thread> worker;
+  std::mutex mutex;
+  std::condition_variable start_cv;
+  std::condition_variable done_cv;
+  size_t generation = 0;
+  int numactive = 0; // WORKERS OF THE CURRENT COPY
+  int pending = 0;
+  bool stop = false;
+
+  // CURRENT COPY
+  std::function<void(size_t, size_t)> job;
+  size_t bytes;
+  std::vector<std::vector<size_t>> chunk; // CHUNKS OF EACH NODE
+  std::vector<std::atomic<size_t>> next;
+
+  static int node_of(int c) {
+    char name[64];
+    snprintf(name, sizeof(name), "/sys/devices/system/cpu/cpu%d", c);
+    DIR *dir = opendir(name);
+    if(dir == nullptr)
+      return 0;
+    int node = 0;
+    while(struct dirent *entry = readdir(dir))
+      if(sscanf(entry->d_name, "node%d", &node) == 1)
+        break;
+    closedir(dir);
+    return node;
+  }
+
+  void init() {
+    if(cpu.size())
+      return;
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    sched_getaffinity(0, sizeof(mask), &mask);
+    std::vector<std::vector<int>> node_cpu;
+    for(int c = 0; c < CPU_SETSIZE; c++)
+      if(CPU_ISSET(c, &mask)) {
+        int node = node_of(c);
+        if(node >= (int)node_cpu.size())
+          node_cpu.resize(node + 1);
+        node_cpu[node].push_back(c);
+      }
+    numnode = node_cpu.size();
+    for(size_t i = 0; (int)cpu.size() < CPU_COUNT(&mask); i++)
+      for(int node = 0; node < numnode; node++)
+        if(i < node_cpu[node].size()) {
+          cpu.push_back(node_cpu[node][i]);
+          cpu_node.push_back(node);
+        }
+    if(cpu.empty()) {
+      cpu.push_back(sched_getcpu());
+      cpu_node.push_back(0);
+      numnode = 1;
+    }
+    next = std::vector<std::atomic<size_t>>(numnode);
+    chunk.resize(numnode);
+  }
+
+  // DEFAULT NUMBER OF THREADS: ONE PER ALLOWED CPU
+  int maxthread() {
+    init();
+    return cpu.size();
+  }
+
+  ~copy_engine_t() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stop = true;
+    }
+    start_cv.notify_all();
+    for(std::thread &thread : worker)
+      thread.join();
+  }
+
+  // WORKER w IS PINNED TO CPU w + 1 OF THE LIST (THE CALLER STAYS WHERE IT RUNS), CYCLICALLY WHEN OVERSUBSCRIBED
+  void work(int w, size_t seen) {
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu[(w + 1) % cpu.size()], &mask);
+    pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask);
+    int node = cpu_node[(w + 1) % cpu.size()];
+    while(true) {
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        start_cv.wait(lock, [&] {return stop || generation != seen;});
+        if(stop)
+          return;
+        seen = generation;
+        if(w >= numactive)
+          continue;
+      }
+      run(node);
+      {
+        std::lock_guard<std::mutex> lock(mutex);
+        if(--pending == 0)
+          done_cv.notify_one();
+      }
+    }
+  }
+
+  void run(int node) {
+    for(int n = 0; n < numnode; n++) {
+      int from = (node + n) % numnode;
+      size_t i;
+      while((i = next[from]++) < chunk[from].size()) {
+        size_t begin = chunk[from][i] * COMMBENCH_COPY_CHUNK;
+        job(begin, std::min(bytes, begin + COMMBENCH_COPY_CHUNK));
+      }
+    }
+  }
+
+  // APPLY func TO ALL CHUNKS OF [0, bytes) WITH numthread THREADS, local IS THE BUFFER OF THIS PROCESS THAT DECIDES THE NUMA PLACEMENT
+  void run(int numthread, size_t bytes, char *local, std::function<void(size_t, size_t)> func) {
+    init();
+    size_t numchunk = (bytes + COMMBENCH_COPY_CHUNK - 1) / COMMBENCH_COPY_CHUNK;
+    numthread = std::min((size_t)numthread, numchunk);
+    if(numthread < 2) {
+      if(bytes)
+        func(0, bytes);
+      return;
+    }
+    while((int)worker.size() < numthread - 1)
+      worker.push_back(std::thread(&copy_engine_t::work, this, (int)worker.size(), generation));
+    // DISTRIBUTE THE CHUNKS OVER THE NODES OF THEIR FIRST PAGES
+    for(std::vector<size_t> &list : chunk)
+      list.clear();
+    std::vector<int> status(numchunk, 0);
+    if(numnode > 1) {
+      std::vector<void*> page(numchunk);
+      for(size_t k = 0; k < numchunk; k++)
+        page[k] = local + k * COMMBENCH_COPY_CHUNK;
+      syscall(SYS_move_pages, 0, numchunk, page.data(), nullptr, status.data(), 0);
+    }
+    for(size_t k = 0; k < numchunk; k++)
+      chunk[status[k] >= 0 && status[k] < numnode ? status[k] : k % numnode].push_back(k);
+    for(std::atomic<size_t> &cursor : next)
+      cursor = 0;
+    job = func;
+    this->bytes = bytes;
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      numactive = numthread - 1;
+      pending = numactive;
+      generation++;
+    }
+    start_cv.notify_all();
+    int here = sched_getcpu();
+    int node = 0;
+    for(size_t i = 0; i < cpu.size(); i++)
+      if(cpu[i] == here)
+        node = cpu_node[i];
+    run(node);
+    std::unique_lock<std::mutex> lock(mutex);
+    done_cv.wait(lock, [&] {return pending == 0;});
+  }
+
+  void copy(int numthread, void *dst, const void *src, size_t bytes) {
+    run(numthread, bytes, (char*)dst, [dst, src](size_t begin, size_t end) {memcpy((char*)dst + begin, (const char*)src + begin, end - begin);});
+  }
+};
+static copy_engine_t copy_engine;
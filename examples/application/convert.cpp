@@ -0,0 +1,22 @@
+// CONVERTS AN N x N TEXT PATTERN INTO THE BINARY CSR FORMAT OF CommBench
+// usage: ./convert 16x16_pattern.txt 16x16_pattern.bin
+
+#include "../../commbench.h"
+
+int main(int argc, char *argv[]) {
+
+  if(argc != 3) {
+    printf("usage: %s pattern.txt pattern.bin\n", argv[0]);
+    return 1;
+  }
+  if(!CommBench::convert_pattern(argv[1], argv[2]))
+    return 1;
+
+  // CHECK BY LOADING BACK THE FIRST ROW
+  CommBench::pattern_t pattern;
+  if(!pattern.load(argv[2], 0))
+    return 1;
+  printf("%s -> %s: numproc %d, process 0 sends %zu elements to %zu processes\n", argv[1], argv[2], pattern.numproc, pattern.sendtotal(), pattern.sendproc.size());
+
+  return 0;
+}
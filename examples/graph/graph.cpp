@@ -0,0 +1,104 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// DATA CHECK OF THE DEPENDENCY GRAPH AND THE PIPELINE (CPU PORT, AT LEAST TWO PROCESSES)
+// the steps have several messages between the same pair of processes, whose dependencies let them be posted
+// in a different order than their matching messages on the other side
+//
+// usage: mpirun -np 2 ./graph
+
+#include "commbench.h"
+
+using namespace CommBench;
+
+int check(const char *name, int *buf, size_t count, int (*expect)(size_t)) {
+  int error = 0;
+  if(myid == 0)
+    for(size_t i = 0; i < count; i++)
+      if(buf[i] != expect(i))
+        error++;
+  allreduce_sum(&error);
+  if(myid == printid)
+    printf("CHECK %s: %d errors\n", name, error);
+  return error;
+}
+
+int main() {
+
+  init();
+  if(numproc < 2) {
+    if(myid == printid)
+      printf("run with at least two processes\n");
+    finalize();
+    return 1;
+  }
+
+  size_t n = 1 << 16;
+  int *a;
+  int *b;
+  int *c;
+  allocate(a, 2 * n);
+  allocate(b, 2 * n);
+  allocate(c, 2 * n);
+  int error = 0;
+
+  for(library lib : {MPI, IPC}) {
+    // GRAPH: 0 -> 1 INTO b[0:n], THEN 1 -> 0 OF b[0:n] (DEPENDENT) AND b[n:2n] (INDEPENDENT)
+    for(size_t i = 0; i < 2 * n; i++) {
+      a[i] = 555;
+      b[i] = (i < n ? -1 : 100);
+      c[i] = -1;
+    }
+    {
+      Comm<int> first(lib);
+      Comm<int> second(lib);
+      first.add(a, 0, b, 0, n, 0, 1);
+      second.add(b, 0, c, 0, n, 1, 0);
+      second.add(b, n, c, n, n, 1, 0);
+      Graph<int> graph;
+      int step = graph.add(first);
+      graph.add(second, {step});
+      graph.commit();
+      graph.start();
+      graph.wait();
+      error += check(lib == MPI ? "graph MPI" : "graph IPC", c, 2 * n, [](size_t i) -> int {return i < (1 << 16) ? 555 : 100;});
+    }
+
+    // PIPELINE: TWO CROSSED MESSAGES PER PAIR IN EACH STAGE
+    for(size_t i = 0; i < 2 * n; i++) {
+      a[i] = i + 1;
+      b[i] = -1;
+      c[i] = -1;
+    }
+    {
+      Comm<int> forward(lib);
+      Comm<int> backward(lib);
+      forward.add(a, 0, b, n, n, 0, 1);
+      forward.add(a, n, b, 0, n, 0, 1);
+      backward.add(b, 0, c, n, n, 1, 0);
+      backward.add(b, n, c, 0, n, 1, 0);
+      std::vector<Comm<int>> sequence = {forward, backward};
+      measure_pipeline(sequence, 4, 1, 3, 2 * n);
+      error += check(lib == MPI ? "pipeline MPI" : "pipeline IPC", c, 2 * n, [](size_t i) -> int {return i + 1;});
+    }
+  }
+
+  free(a);
+  free(b);
+  free(c);
+  finalize();
+
+  return error ? 1 : 0;
+}
@@ -204,7 +204,10 @@ int main(int argc, char *argv[])
 
   CommBench::report_memory();
 
-  bench.measure(warmup, numiter, data);
+  if(window > 1)
+    bench.measure_window(warmup, numiter, window, data);
+  else
+    bench.measure(warmup, numiter, data);
 
   MPI_Finalize();
 
@@ -47,6 +47,18 @@ int main() {
     // measure end-to-end
     measure_async(striping, 5, 10, count);
 
+    // measure with dependencies: each process starts its messages as soon as its own inputs are ready
+    Graph<int> graph;
+    int step_split = graph.add(split);
+    int step_translate = graph.add(translate, {step_split});
+    graph.add(assemble, {step_translate});
+    graph.commit();
+    graph.measure(5, 10, count);
+
+    // pipelined: chunk k of a stage overlaps with chunk k + 1 of the previous stage
+    for(int numchunk : {2, 4, 8, 16})
+      measure_pipeline(striping, numchunk, 5, 10, count);
+
     free(sendbuf_d);
     free(recvbuf_d);
     free(temp_d);
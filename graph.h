@@ -0,0 +1,302 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// DEPENDENCY GRAPH OF COMMUNICATION STEPS
+// each step is a registered Comm that declares the earlier steps it depends on
+// the dependencies are resolved per buffer on each process: a message waits only for the local messages of the ancestor steps
+// whose buffer regions it overlaps (read after write, write after read, write after write)
+// when all steps use MPI, each process posts its messages as soon as their local inputs are ready. since messages may be posted
+// in a different order than their matching messages on the other side, each message has its own tag: the base of its step plus
+// its ordinal among the messages of the step between the same sender and receiver
+// otherwise steps are started in the same order on all processes and each step is waited only before a dependent step starts
+// ready steps are taken in the order of their critical path: the heaviest chain of steps (in bytes) to the end of the graph
+
+template <typename T>
+class Graph {
+
+  struct message_t {
+    int step;
+    bool send;
+    int index; // index of the send or the receive in the step
+    int tag;
+    char *begin;
+    char *end;
+    std::vector<int> succ;
+    int numdep = 0;
+  };
+
+  std::vector<Comm<T>*> step;
+  std::vector<std::vector<int>> depend;
+  std::vector<double> priority;
+  std::vector<int> order; // step order by priority, consistent with the dependencies
+  bool fine = false;
+
+  // MESSAGE-LEVEL SCHEDULE (MPI)
+  std::vector<message_t> message;
+  std::vector<int> remaining;
+  std::vector<int> ready;
+  int numdone;
+#ifdef USE_MPI
+  std::vector<MPI_Request> request;
+  std::vector<int> done;
+#endif
+  // STEP-LEVEL SCHEDULE
+  std::vector<bool> waited;
+
+  void post(int m) {
+#ifdef USE_MPI
+    message_t &msg = message[m];
+    Comm<T> &comm = *step[msg.step];
+    if(msg.send)
+      MPI_Isend(msg.begin, msg.end - msg.begin, MPI_BYTE, comm.sendproc[msg.index], msg.tag, comm_mpi, &request[m]);
+    else
+      MPI_Irecv(msg.begin, msg.end - msg.begin, MPI_BYTE, comm.recvproc[msg.index], msg.tag, comm_mpi, &request[m]);
+#endif
+  }
+  void post_ready() {
+    // RECEIVES FIRST, THEN BY CRITICAL PATH
+    std::stable_sort(ready.begin(), ready.end(), [this](const int &a, const int &b) -> bool {
+      if(message[a].send != message[b].send)
+        return !message[a].send;
+      return priority[message[a].step] > priority[message[b].step];
+    });
+    for(int m : ready)
+      post(m);
+    ready.clear();
+  }
+
+  public:
+
+  // RETURNS THE INDEX OF THE STEP, DEPENDENCIES ARE INDICES OF EARLIER STEPS
+  int add(Comm<T> &comm, std::vector<int> depend) {
+    std::vector<int> valid;
+    for(int d : depend) {
+      if(d < 0 || d >= (int)step.size()) {
+        if(myid == printid)
+          printf("Graph step %zu cannot depend on step %d, ignored\n", step.size(), d);
+      }
+      else
+        valid.push_back(d);
+    }
+    step.push_back(&comm);
+    this->depend.push_back(valid);
+    return step.size() - 1;
+  }
+  int add(Comm<T> &comm) {
+    return add(comm, std::vector<int>());
+  }
+
+  // RESOLVE THE DEPENDENCIES AND PRIORITIES (COLLECTIVE)
+  void commit() {
+    int numstep = step.size();
+    // CRITICAL PATH IN BYTES OF THE HEAVIEST PROCESS OF EACH STEP
+    std::vector<double> cost(numstep, 0);
+    for(int s = 0; s < numstep; s++) {
+      size_t bytes = 0;
+      for(int send = 0; send < step[s]->numsend; send++)
+        bytes += step[s]->sendcount[send] * sizeof(T);
+      allreduce_max(&bytes);
+      cost[s] = bytes;
+    }
+    priority = cost;
+    for(int s = numstep - 1; s >= 0; s--)
+      for(int d : depend[s])
+        priority[d] = std::max(priority[d], cost[d] + priority[s]);
+    // LIST SCHEDULING: THE READY STEP WITH THE LONGEST CRITICAL PATH IS TAKEN FIRST
+    order.clear();
+    std::vector<int> numdep(numstep);
+    for(int s = 0; s < numstep; s++)
+      numdep[s] = depend[s].size();
+    std::vector<bool> taken(numstep, false);
+    for(int i = 0; i < numstep; i++) {
+      int next = -1;
+      for(int s = 0; s < numstep; s++)
+        if(!taken[s] && numdep[s] == 0 && (next < 0 || priority[s] > priority[next]))
+          next = s;
+      taken[next] = true;
+      order.push_back(next);
+      for(int s = 0; s < numstep; s++)
+        for(int d : depend[s])
+          if(d == next)
+            numdep[s]--;
+    }
+    fine = numstep > 0;
+    for(int s = 0; s < numstep; s++)
+      if(step[s]->lib != MPI)
+        fine = false;
+    // ANCESTORS OF EACH STEP
+    std::vector<std::vector<bool>> ancestor(numstep, std::vector<bool>(numstep, false));
+    for(int s = 0; s < numstep; s++)
+      for(int d : depend[s]) {
+        ancestor[s][d] = true;
+        for(int a = 0; a < numstep; a++)
+          if(ancestor[d][a])
+            ancestor[s][a] = true;
+      }
+    // LOCAL MESSAGES AND THEIR BUFFER REGIONS
+    // THE k-TH SEND FROM p TO q OF A STEP MATCHES THE k-TH RECEIVE AT q FROM p, AS IN Comm
+    message.clear();
+    int tag = 1; // TAG 0 IS USED BY Comm
+    for(int s = 0; s < numstep; s++) {
+      Comm<T> &comm = *step[s];
+      std::vector<int> sendord(numproc, 0);
+      std::vector<int> recvord(numproc, 0);
+      int maxord = 0;
+      for(int send = 0; send < comm.numsend; send++) {
+        char *begin = (char*)(comm.sendbuf[send] + comm.sendoffset[send]);
+        int ord = sendord[comm.sendproc[send]]++;
+        maxord = std::max(maxord, ord + 1);
+        message.push_back({s, true, send, tag + ord, begin, begin + comm.sendcount[send] * sizeof(T), {}, 0});
+      }
+      for(int recv = 0; recv < comm.numrecv; recv++) {
+        char *begin = (char*)(comm.recvbuf[recv] + comm.recvoffset[recv]);
+        int ord = recvord[comm.recvproc[recv]]++;
+        maxord = std::max(maxord, ord + 1);
+        message.push_back({s, false, recv, tag + ord, begin, begin + comm.recvcount[recv] * sizeof(T), {}, 0});
+      }
+      allreduce_max(&maxord);
+      tag += maxord;
+    }
+#ifdef USE_MPI
+    if(fine) {
+      int *tag_ub;
+      int flag;
+      MPI_Comm_get_attr(comm_mpi, MPI_TAG_UB, &tag_ub, &flag);
+      if(flag && tag - 1 > *tag_ub) {
+        if(myid == printid)
+          printf("Graph needs %d tags, more than MPI_TAG_UB %d, falls back to step-level schedule\n", tag - 1, *tag_ub);
+        fine = false;
+      }
+    }
+#endif
+    // A MESSAGE DEPENDS ON THE OVERLAPPING MESSAGES OF ANCESTOR STEPS UNLESS BOTH ONLY READ
+    int numedge = 0;
+    for(size_t m = 0; m < message.size(); m++)
+      for(size_t a = 0; a < message.size(); a++) {
+        message_t &x = message[m];
+        message_t &y = message[a];
+        if(ancestor[x.step][y.step] && !(x.send && y.send) && x.begin < y.end && y.begin < x.end) {
+          y.succ.push_back(m);
+          x.numdep++;
+          numedge++;
+        }
+      }
+    allreduce_sum(&numedge);
+    if(myid == printid) {
+      printf("Graph of %d steps (%s), %d local dependencies\n", numstep, fine ? "message-level MPI" : "step-level", numedge);
+      for(int s : order) {
+        printf("step %d bench %d priority ", s, step[s]->benchid);
+        print_data(priority[s]);
+        printf(" depends on:");
+        for(int d : depend[s])
+          printf(" %d", d);
+        printf("\n");
+      }
+      printf("\n");
+    }
+  }
+
+  void start() {
+    if(fine) {
+#ifdef USE_MPI
+      request.assign(message.size(), MPI_REQUEST_NULL);
+      done.resize(message.size());
+      remaining.resize(message.size());
+      for(size_t m = 0; m < message.size(); m++) {
+        remaining[m] = message[m].numdep;
+        if(remaining[m] == 0)
+          ready.push_back(m);
+      }
+      numdone = 0;
+      post_ready();
+#endif
+    }
+    else {
+      waited.assign(step.size(), false);
+      for(int s : order) {
+        // DEFERRED WAIT: ONLY WHEN A DEPENDENT STEP IS ABOUT TO START
+        for(int d : depend[s])
+          if(!waited[d]) {
+            step[d]->wait();
+            waited[d] = true;
+          }
+        step[s]->start();
+      }
+    }
+  }
+
+  void wait() {
+    if(fine) {
+#ifdef USE_MPI
+      while(numdone < (int)message.size()) {
+        int numcomplete;
+        MPI_Waitsome(message.size(), request.data(), &numcomplete, done.data(), MPI_STATUSES_IGNORE);
+        if(numcomplete == MPI_UNDEFINED)
+          break; // NOTHING IS POSTED, CANNOT HAPPEN WITHOUT A CYCLE
+        for(int i = 0; i < numcomplete; i++) {
+          message_t &msg = message[done[i]];
+          trace(msg.send ? "send" : "recv", 'i', step[msg.step]->benchid, msg.index);
+          for(int m : msg.succ)
+            if(--remaining[m] == 0)
+              ready.push_back(m);
+        }
+        numdone += numcomplete;
+        post_ready();
+      }
+#endif
+    }
+    else
+      for(int s : order)
+        if(!waited[s]) {
+          step[s]->wait();
+          waited[s] = true;
+        }
+  }
+
+  void measure(int warmup, int numiter, size_t count) {
+    histogram_t hist;
+    measure(warmup, numiter, count, hist, "graph");
+  }
+  void measure(int warmup, int numiter, size_t count, histogram_t &hist, const char *mode) {
+    std::vector<double> t;
+    for(int iter = -warmup; iter < numiter; iter++) {
+      barrier();
+      trace("iteration", 'B', -1, iter);
+      double time = wtime();
+      start();
+      wait();
+      time = timer_correct(wtime() - time);
+      trace("iteration", 'E', -1, iter);
+      allreduce_max(&time);
+      if(iter >= 0) {
+        hist.add(time);
+        if(numiter <= COMMBENCH_SORTED_ITER)
+          t.push_back(time);
+      }
+    }
+    print_stats(hist, t, count * sizeof(T));
+    size_t sendbytes = 0;
+    size_t recvbytes = 0;
+    int numcomm = 0;
+    for(Comm<T> *comm : step) {
+      for(int send = 0; send < comm->numsend; send++)
+        sendbytes += comm->sendcount[send] * sizeof(T);
+      for(int recv = 0; recv < comm->numrecv; recv++)
+        recvbytes += comm->recvcount[recv] * sizeof(T);
+      numcomm += comm->numcomm;
+    }
+    results_record(mode, -1, step.size() ? lib_name(step[0]->lib) : "dummy", numcomm, count, count * sizeof(T), sendbytes, recvbytes, hist, t);
+  }
+};
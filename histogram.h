@@ -0,0 +1,130 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// LATENCY HISTOGRAM
+// values are recorded in nanoseconds into log buckets: each power of two is split into
+// 2^HIST_SUBBITS linear sub-buckets (0.8% relative error), up to 2^HIST_MAXBITS ns (~18 minutes)
+// min, max, and sum are kept exact, the memory is constant regardless of the number of iterations
+
+#define HIST_SUBBITS 7
+#define HIST_MAXBITS 40
+
+struct histogram_t {
+
+  static const int numbucket = (HIST_MAXBITS - HIST_SUBBITS + 2) << HIST_SUBBITS;
+
+  std::vector<uint64_t> bucket;
+  uint64_t count = 0;
+  double sum = 0;
+  double min = 0;
+  double max = 0;
+
+  histogram_t() : bucket(numbucket, 0) {}
+
+  static int index(double time) {
+    uint64_t ns = time > 0 ? (uint64_t)(time * 1e9) : 0;
+    if(ns < (1ul << HIST_SUBBITS))
+      return ns;
+    int exp = 63 - __builtin_clzll(ns);
+    if(exp > HIST_MAXBITS)
+      return numbucket - 1;
+    return ((exp - HIST_SUBBITS + 1) << HIST_SUBBITS) + (int)((ns >> (exp - HIST_SUBBITS)) - (1ul << HIST_SUBBITS));
+  }
+  // MIDPOINT OF A BUCKET IN SECONDS
+  static double value(int index) {
+    if(index < (1 << HIST_SUBBITS))
+      return index * 1e-9;
+    int shift = (index >> HIST_SUBBITS) - 1;
+    uint64_t lower = ((uint64_t)(index & ((1 << HIST_SUBBITS) - 1)) + (1ul << HIST_SUBBITS)) << shift;
+    return (lower + (1ul << shift) / 2.0) * 1e-9;
+  }
+
+  void add(double time) {
+    if(count == 0 || time < min)
+      min = time;
+    if(count == 0 || time > max)
+      max = time;
+    bucket[index(time)]++;
+    sum += time;
+    count++;
+  }
+  void merge(const histogram_t &other) {
+    if(other.count == 0)
+      return;
+    if(count == 0 || other.min < min)
+      min = other.min;
+    if(count == 0 || other.max > max)
+      max = other.max;
+    for(int i = 0; i < numbucket; i++)
+      bucket[i] += other.bucket[i];
+    sum += other.sum;
+    count += other.count;
+  }
+  // MERGE HISTOGRAMS OF ALL PROCESSES (COLLECTIVE)
+  void allreduce() {
+    double minmax[2] = {count ? -min : -HUGE_VAL, count ? max : -HUGE_VAL};
+    CommBench::allreduce(minmax, minmax, 2, [](const double &a, const double &b) -> double {return (a > b ? a : b);});
+    CommBench::allreduce(bucket.data(), bucket.data(), numbucket, [](const uint64_t &a, const uint64_t &b) -> uint64_t {return a + b;});
+    allreduce_sum(&sum);
+    allreduce_sum(&count);
+    min = -minmax[0];
+    max = minmax[1];
+  }
+
+  double mean() {
+    return count ? sum / count : 0;
+  }
+  // p IS IN [0, 1], e.g., 0.999 FOR p99.9
+  double percentile(double p) {
+    if(count == 0)
+      return 0;
+    uint64_t rank = (uint64_t)ceil(p * count);
+    if(rank < 1)
+      rank = 1;
+    uint64_t total = 0;
+    for(int i = 0; i < numbucket; i++) {
+      total += bucket[i];
+      if(total >= rank) {
+        double time = value(i);
+        return time < min ? min : (time > max ? max : time);
+      }
+    }
+    return max;
+  }
+
+  void print(size_t data) {
+    double stats[7] = {min, percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), max, mean()};
+    const char *name[7] = {"minTime", "medTime", "p90Time", "p99Time", "p999Time", "maxTime", "avgTime"};
+    if(myid == printid) {
+      printf("data: "); print_data(data); printf("\n");
+      for(int i = 0; i < 7; i++)
+        printf("%s: %.4e us, %.4e ms/GB, %.4e GB/s\n", name[i], stats[i] * 1e6, stats[i] / data * 1e12, data / stats[i] / 1e9);
+      printf("\n");
+    }
+  }
+  // SIDE BY SIDE WITH THE SAME PATTERN MEASURED WITH COLD CACHES
+  void print(size_t data, histogram_t &cold) {
+    double hot_stats[5] = {min, percentile(0.5), percentile(0.99), max, mean()};
+    double cold_stats[5] = {cold.min, cold.percentile(0.5), cold.percentile(0.99), cold.max, cold.mean()};
+    const char *name[5] = {"minTime", "medTime", "p99Time", "maxTime", "avgTime"};
+    if(myid == printid) {
+      printf("data: "); print_data(data); printf(" hot vs. cold cache\n");
+      printf("stat hot(us) cold(us) hot(GB/s) cold(GB/s) cold/hot\n");
+      for(int i = 0; i < 5; i++)
+        printf("%s %.4e %.4e %.4e %.4e %.2f\n", name[i], hot_stats[i] * 1e6, cold_stats[i] * 1e6, data / hot_stats[i] / 1e9, data / cold_stats[i] / 1e9, cold_stats[i] / hot_stats[i]);
+      printf("\n");
+    }
+  }
+};
@@ -0,0 +1,106 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Cost of the bootstrap helpers (broadcast, allgather, allreduce) versus the number of processes.
+// The pair-based versions are kept here as reference for comparison.
+
+// #define USE_GASNET
+#include "../../commbench.h"
+
+using namespace CommBench;
+
+// PAIR-BASED REFERENCE
+template <typename T>
+void pair_broadcast(T *sendbuf, T *recvbuf, int root) {
+  T temp;
+  for(int i = 0; i < numproc; i++)
+    pair(sendbuf, &temp, root, i);
+  *recvbuf = temp;
+}
+template <typename T>
+void pair_allgather(T *sendval, T *recvbuf) {
+  for(int root = 0; root < numproc; root++)
+    pair_broadcast(sendval, recvbuf + root, root);
+}
+template <typename T>
+void pair_allreduce_max(T *sendbuf, T *recvbuf) {
+  std::vector<T> temp(numproc);
+  pair_allgather(sendbuf, temp.data());
+  T max = *sendbuf;
+  for(int i = 0; i < numproc; i++)
+    if(temp[i] > max)
+      max = temp[i];
+  *recvbuf = max;
+}
+
+template <typename F>
+double measure_helper(int numiter, F func) {
+  func(); // warmup
+  barrier();
+  double time = omp_get_wtime();
+  for(int iter = 0; iter < numiter; iter++)
+    func();
+  time = (omp_get_wtime() - time) / numiter;
+  allreduce_max(&time);
+  return time;
+}
+
+int main(int argc, char *argv[]) {
+
+  init();
+
+  int numiter = (argc > 1 ? atoi(argv[1]) : 100);
+
+  double value = myid;
+  std::vector<double> values(numproc);
+  bool pass = true;
+
+  // VERIFY
+  {
+    double sum;
+    double max;
+    allreduce_sum(&value, &sum);
+    allreduce_max(&value, &max);
+    allgather(&value, values.data());
+    for(int i = 0; i < numproc; i++)
+      if(values[i] != i)
+        pass = false;
+    if(sum != numproc * (numproc - 1) / 2.0 || max != numproc - 1)
+      pass = false;
+    double root = -1;
+    broadcast(&value, &root, numproc - 1);
+    if(root != numproc - 1)
+      pass = false;
+    pass = allreduce_land(pass);
+  }
+
+  double time_bcast = measure_helper(numiter, [&]() {broadcast(&value, &value, 0);});
+  double time_allgather = measure_helper(numiter, [&]() {allgather(&value, values.data());});
+  double time_allreduce = measure_helper(numiter, [&]() {allreduce_max(&value, &value);});
+  double pair_bcast = measure_helper(numiter, [&]() {pair_broadcast(&value, &value, 0);});
+  double pair_allgather_time = measure_helper(numiter, [&]() {pair_allgather(&value, values.data());});
+  double pair_allreduce = measure_helper(numiter, [&]() {pair_allreduce_max(&value, &value);});
+
+  if(myid == printid) {
+    printf("verification: %s\n", pass ? "PASSED" : "FAILED");
+    printf("numproc %d numiter %d\n", numproc, numiter);
+    printf("helper        log(us)     pair(us)    speedup\n");
+    printf("broadcast     %.4e  %.4e  %.2f\n", time_bcast * 1e6, pair_bcast * 1e6, pair_bcast / time_bcast);
+    printf("allgather     %.4e  %.4e  %.2f\n", time_allgather * 1e6, pair_allgather_time * 1e6, pair_allgather_time / time_allgather);
+    printf("allreduce_max %.4e  %.4e  %.2f\n", time_allreduce * 1e6, pair_allreduce * 1e6, pair_allreduce / time_allreduce);
+  }
+
+  finalize();
+}
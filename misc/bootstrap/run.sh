@@ -0,0 +1,10 @@
+#!/bin/bash
+
+# cost of bootstrap helpers versus number of processes
+
+numiter=100
+
+for numproc in 2 4 8 16 32 64
+do
+  mpirun -np $numproc ./bootstrap $numiter
+done
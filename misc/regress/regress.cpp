@@ -0,0 +1,234 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Baseline database and regression comparison for CommBench results (see results_init() in commbench.h).
+// Records of process 0 in the JSON-lines results carry the per-iteration times, they are keyed by
+// machine | pattern | library | bytes, where machine is COMMBENCH_MACHINE in the recorded environment (host otherwise)
+// and pattern is COMMBENCH_PATTERN in the recorded environment (mode, numproc, and numcomm otherwise).
+//
+// usage: ./regress store baseline.db results.jsonl ...
+//        ./regress compare baseline.db results.jsonl ... [-alpha 0.01] [-threshold 0.02]
+// compare returns 1 if any configuration is regressed.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <string>
+#include <vector>
+
+// MINIMAL FIELD EXTRACTION FROM THE FLAT RECORDS WRITTEN BY CommBench
+static bool get_string(const std::string &record, const char *field, std::string &value) {
+  size_t pos = record.find(std::string("\"") + field + "\": \"");
+  if(pos == std::string::npos)
+    return false;
+  value.clear();
+  for(pos += strlen(field) + 5; pos < record.size() && record[pos] != '"'; pos++) {
+    if(record[pos] == '\\')
+      pos++;
+    value += record[pos];
+  }
+  return true;
+}
+static bool get_number(const std::string &record, const char *field, double &value) {
+  size_t pos = record.find(std::string("\"") + field + "\": ");
+  if(pos == std::string::npos)
+    return false;
+  value = strtod(record.c_str() + pos + strlen(field) + 4, nullptr);
+  return true;
+}
+static bool get_array(const std::string &record, const char *field, std::vector<double> &values) {
+  size_t pos = record.find(std::string("\"") + field + "\": [");
+  if(pos == std::string::npos)
+    return false;
+  const char *ptr = record.c_str() + pos + strlen(field) + 5;
+  values.clear();
+  while(*ptr && *ptr != ']') {
+    char *end;
+    double val = strtod(ptr, &end);
+    if(end == ptr)
+      break;
+    values.push_back(val);
+    ptr = end;
+    while(*ptr == ',' || *ptr == ' ')
+      ptr++;
+  }
+  return true;
+}
+
+// READ KEYED SAMPLES FROM RESULTS FILES
+static void read_results(const char *filename, std::map<std::string, std::vector<double>> &samples) {
+  std::ifstream file(filename);
+  if(!file) {
+    printf("cannot open %s\n", filename);
+    exit(2);
+  }
+  std::string record;
+  while(std::getline(file, record)) {
+    double proc;
+    std::vector<double> iters;
+    if(!get_number(record, "proc", proc) || proc != 0 || !get_array(record, "iters", iters) || iters.empty())
+      continue;
+    std::string machine, pattern, lib, mode;
+    double bytes, numproc, numcomm;
+    if(!get_string(record, "COMMBENCH_MACHINE", machine))
+      get_string(record, "host", machine);
+    if(!get_string(record, "COMMBENCH_PATTERN", pattern)) {
+      get_string(record, "mode", mode);
+      get_number(record, "numproc", numproc);
+      get_number(record, "numcomm", numcomm);
+      pattern = mode + " numproc " + std::to_string((long)numproc) + " numcomm " + std::to_string((long)numcomm);
+    }
+    get_string(record, "lib", lib);
+    get_number(record, "bytes", bytes);
+    std::string key = machine + " | " + pattern + " | " + lib + " | " + std::to_string((long)bytes);
+    std::vector<double> &sample = samples[key];
+    sample.insert(sample.end(), iters.begin(), iters.end());
+  }
+}
+
+// BASELINE DATABASE: ONE LINE PER CONFIGURATION, KEY <TAB> TIMES
+static void read_db(const char *filename, std::map<std::string, std::vector<double>> &db) {
+  std::ifstream file(filename);
+  std::string line;
+  while(std::getline(file, line)) {
+    size_t tab = line.find('\t');
+    if(tab == std::string::npos)
+      continue;
+    std::vector<double> &sample = db[line.substr(0, tab)];
+    const char *ptr = line.c_str() + tab + 1;
+    char *end;
+    for(double val = strtod(ptr, &end); end != ptr; val = strtod(ptr, &end)) {
+      sample.push_back(val);
+      ptr = end;
+    }
+  }
+}
+static void write_db(const char *filename, std::map<std::string, std::vector<double>> &db) {
+  FILE *fp = fopen(filename, "w");
+  if(!fp) {
+    printf("cannot open %s\n", filename);
+    exit(2);
+  }
+  for(auto &entry : db) {
+    fprintf(fp, "%s\t", entry.first.c_str());
+    for(double val : entry.second)
+      fprintf(fp, " %.6e", val);
+    fprintf(fp, "\n");
+  }
+  fclose(fp);
+}
+
+static double median(std::vector<double> sample) {
+  std::sort(sample.begin(), sample.end());
+  size_t n = sample.size();
+  return n % 2 ? sample[n / 2] : (sample[n / 2 - 1] + sample[n / 2]) / 2;
+}
+
+// TWO-SIDED MANN-WHITNEY U TEST (NORMAL APPROXIMATION WITH TIE AND CONTINUITY CORRECTIONS)
+static double mann_whitney(const std::vector<double> &a, const std::vector<double> &b) {
+  std::vector<std::pair<double, int>> all;
+  for(double val : a)
+    all.push_back(std::make_pair(val, 0));
+  for(double val : b)
+    all.push_back(std::make_pair(val, 1));
+  std::sort(all.begin(), all.end());
+  double n1 = a.size();
+  double n2 = b.size();
+  double n = n1 + n2;
+  double ranksum = 0;
+  double ties = 0;
+  for(size_t i = 0; i < all.size();) {
+    size_t j = i;
+    while(j < all.size() && all[j].first == all[i].first)
+      j++;
+    double rank = (i + 1 + j) / 2.0;
+    for(size_t k = i; k < j; k++)
+      if(all[k].second == 0)
+        ranksum += rank;
+    double t = j - i;
+    ties += t * t * t - t;
+    i = j;
+  }
+  double u = ranksum - n1 * (n1 + 1) / 2;
+  double mean = n1 * n2 / 2;
+  double sigma = sqrt(n1 * n2 / 12 * ((n + 1) - ties / (n * (n - 1))));
+  if(sigma == 0)
+    return 1;
+  double z = (fabs(u - mean) - 0.5) / sigma;
+  return z > 0 ? erfc(z / sqrt(2)) : 1;
+}
+
+int main(int argc, char *argv[]) {
+
+  if(argc < 4 || (strcmp(argv[1], "store") && strcmp(argv[1], "compare"))) {
+    printf("usage: %s store baseline.db results.jsonl ...\n", argv[0]);
+    printf("       %s compare baseline.db results.jsonl ... [-alpha 0.01] [-threshold 0.02]\n", argv[0]);
+    return 2;
+  }
+  double alpha = 0.01;
+  double threshold = 0.02;
+  std::map<std::string, std::vector<double>> run;
+  for(int i = 3; i < argc; i++) {
+    if(!strcmp(argv[i], "-alpha") && i + 1 < argc)
+      alpha = atof(argv[++i]);
+    else if(!strcmp(argv[i], "-threshold") && i + 1 < argc)
+      threshold = atof(argv[++i]);
+    else
+      read_results(argv[i], run);
+  }
+  std::map<std::string, std::vector<double>> db;
+  read_db(argv[2], db);
+
+  if(!strcmp(argv[1], "store")) {
+    // A NEW RUN REPLACES THE BASELINE OF ITS CONFIGURATIONS
+    for(auto &entry : run)
+      db[entry.first] = entry.second;
+    write_db(argv[2], db);
+    printf("%zu configurations stored, %zu in %s\n", run.size(), db.size(), argv[2]);
+    return 0;
+  }
+
+  // COMPARE: A CONFIGURATION CHANGES IF THE TEST IS SIGNIFICANT AND THE MEDIAN MOVES MORE THAN THE THRESHOLD
+  int numregress = 0;
+  int numimprove = 0;
+  printf("verdict change p-value baseline(us) new(us) configuration\n");
+  for(auto &entry : run) {
+    auto base = db.find(entry.first);
+    if(base == db.end()) {
+      printf("NEW - - - %.4e %s\n", median(entry.second) * 1e6, entry.first.c_str());
+      continue;
+    }
+    double before = median(base->second);
+    double after = median(entry.second);
+    double change = (after - before) / before;
+    double p = mann_whitney(base->second, entry.second);
+    const char *verdict = "SAME";
+    if(p < alpha && change > threshold) {
+      verdict = "REGRESSED";
+      numregress++;
+    }
+    else if(p < alpha && change < -threshold) {
+      verdict = "IMPROVED";
+      numimprove++;
+    }
+    printf("%s %+.2f%% %.2e %.4e %.4e %s\n", verdict, change * 100, p, before * 1e6, after * 1e6, entry.first.c_str());
+  }
+  printf("%d regressed, %d improved, %zu compared\n", numregress, numimprove, run.size());
+  return numregress ? 1 : 0;
+}
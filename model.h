@@ -0,0 +1,270 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// PERFORMANCE MODEL
+// message time is fitted per library and link class from size sweeps as piecewise Hockney segments t = alpha + beta * bytes,
+// where the segments are separated at the knees of the curve (e.g., eager / rendezvous switch points)
+// LogGP parameters are derived from the segments and from the measured send overhead o and gap g of the smallest messages
+// file format: one line per library and link class
+// lib link L o g G numseg bytes_0 alpha_0 beta_0 ... (lib and link are the enum values, times in seconds)
+
+enum link_class {link_self, link_intra, link_inter, numlink};
+
+static const char *link_name(int link) {
+  switch(link) {
+    case link_self  : return "self";
+    case link_intra : return "intra-node";
+    case link_inter : return "inter-node";
+  }
+  return "unknown";
+}
+
+// NODE INDEX OF EACH PROCESS, FOUND FROM THE HOSTNAMES (COLLECTIVE AT FIRST CALL)
+static std::vector<int> nodeid;
+static void find_nodes() {
+  if(nodeid.size())
+    return;
+  struct host_t {
+    char name[64];
+  };
+  host_t host = {{0}};
+  gethostname(host.name, sizeof(host.name) - 1);
+  std::vector<host_t> hosts(numproc);
+  allgather(&host, hosts.data());
+  nodeid.resize(numproc);
+  for(int p = 0; p < numproc; p++) {
+    nodeid[p] = p;
+    for(int q = 0; q < p; q++)
+      if(!strcmp(hosts[p].name, hosts[q].name)) {
+        nodeid[p] = nodeid[q];
+        break;
+      }
+  }
+}
+static int link_of(int sendid, int recvid) {
+  if(sendid == recvid)
+    return link_self;
+  return nodeid[sendid] == nodeid[recvid] ? link_intra : link_inter;
+}
+
+struct model_t {
+
+  struct segment_t {
+    double bytes; // smallest message size of the segment
+    double alpha;
+    double beta;
+  };
+
+  struct entry_t {
+    int lib;
+    int link;
+    double L;
+    double o;
+    double g;
+    double G;
+    std::vector<segment_t> segment;
+    double alpha(double bytes) const {
+      size_t s = 0;
+      while(s + 1 < segment.size() && segment[s + 1].bytes <= bytes)
+        s++;
+      return segment[s].alpha;
+    }
+    double beta(double bytes) const {
+      size_t s = 0;
+      while(s + 1 < segment.size() && segment[s + 1].bytes <= bytes)
+        s++;
+      return segment[s].beta;
+    }
+    double time(double bytes) const {
+      return alpha(bytes) + beta(bytes) * bytes;
+    }
+  };
+
+  std::vector<entry_t> entry;
+
+  entry_t *find(int lib, int link) {
+    for(entry_t &e : entry)
+      if(e.lib == lib && e.link == link)
+        return &e;
+    return nullptr;
+  }
+
+  // LEAST SQUARES OF THE RELATIVE ERROR (WEIGHTS 1 / t^2) WITH NONNEGATIVE PARAMETERS, RETURNS THE SUM OF SQUARED RELATIVE ERRORS
+  static double hockney(const std::vector<double> &bytes, const std::vector<double> &time, int lo, int hi, double &alpha, double &beta) {
+    double sw = 0, sm = 0, smm = 0, st = 0, smt = 0;
+    for(int i = lo; i < hi; i++) {
+      double w = 1 / (time[i] * time[i]);
+      sw += w;
+      sm += w * bytes[i];
+      smm += w * bytes[i] * bytes[i];
+      st += w * time[i];
+      smt += w * bytes[i] * time[i];
+    }
+    double det = sw * smm - sm * sm;
+    alpha = det > 0 ? (smm * st - sm * smt) / det : st / sw;
+    beta = det > 0 ? (sw * smt - sm * st) / det : 0;
+    if(beta < 0) {
+      beta = 0;
+      alpha = st / sw;
+    }
+    if(alpha < 0) {
+      alpha = 0;
+      beta = smt / smm;
+    }
+    double error = 0;
+    for(int i = lo; i < hi; i++) {
+      double r = (alpha + beta * bytes[i] - time[i]) / time[i];
+      error += r * r;
+    }
+    return error;
+  }
+
+  // BINARY SEGMENTATION: SPLIT WHERE TWO LINES FIT MUCH BETTER THAN ONE, EACH SEGMENT KEEPS AT LEAST TWO POINTS
+  static void segment(const std::vector<double> &bytes, const std::vector<double> &time, int lo, int hi, int depth, std::vector<int> &knee) {
+    double alpha, beta;
+    double error = hockney(bytes, time, lo, hi, alpha, beta);
+    if(depth == 0 || hi - lo < 4 || error / (hi - lo) < 0.05 * 0.05) // WITHIN 5% RMS
+      return;
+    int best = -1;
+    double best_error = error / 4;
+    for(int k = lo + 2; k <= hi - 2; k++) {
+      double split = hockney(bytes, time, lo, k, alpha, beta) + hockney(bytes, time, k, hi, alpha, beta);
+      if(split < best_error) {
+        best_error = split;
+        best = k;
+      }
+    }
+    if(best < 0)
+      return;
+    segment(bytes, time, lo, best, depth - 1, knee);
+    knee.push_back(best);
+    segment(bytes, time, best, hi, depth - 1, knee);
+  }
+
+  // FIT A LIBRARY AND LINK CLASS FROM (MESSAGE SIZE, TIME) POINTS, AND THE OVERHEAD AND GAP OF THE SMALLEST MESSAGE
+  void fit(int lib, int link, std::vector<double> bytes, std::vector<double> time, double o, double g) {
+    std::vector<int> order(bytes.size());
+    for(size_t i = 0; i < order.size(); i++)
+      order[i] = i;
+    std::sort(order.begin(), order.end(), [&](const int &a, const int &b) -> bool {return bytes[a] < bytes[b];});
+    std::vector<double> m, t;
+    for(int i : order)
+      if(time[i] > 0) {
+        m.push_back(bytes[i]);
+        t.push_back(time[i]);
+      }
+    if(m.size() < 2)
+      return;
+    std::vector<int> knee;
+    segment(m, t, 0, m.size(), 2, knee);
+    entry_t e;
+    e.lib = lib;
+    e.link = link;
+    int lo = 0;
+    knee.push_back(m.size());
+    for(int hi : knee) {
+      segment_t s;
+      hockney(m, t, lo, hi, s.alpha, s.beta);
+      s.bytes = lo ? m[lo] : 0;
+      e.segment.push_back(s);
+      lo = hi;
+    }
+    e.o = o;
+    e.g = g;
+    e.G = e.segment.back().beta;
+    e.L = std::max(e.segment[0].alpha - 2 * o, 0.0);
+    entry_t *old = find(lib, link);
+    if(old)
+      *old = e;
+    else
+      entry.push_back(e);
+    if(myid == printid) {
+      double alpha, beta;
+      hockney(m, t, 0, m.size(), alpha, beta);
+      printf("model of %s %s: Hockney alpha %.4e us beta %.4e ns/B (%.4e GB/s)\n", lib_name((library)lib), link_name(link), alpha * 1e6, beta * 1e9, beta > 0 ? 1e-9 / beta : 0.0);
+      printf("LogGP: L %.4e us o %.4e us g %.4e us G %.4e ns/B\n", e.L * 1e6, e.o * 1e6, e.g * 1e6, e.G * 1e9);
+      for(size_t s = 0; s < e.segment.size(); s++) {
+        if(s)
+          printf("knee at ");
+        else
+          printf("from ");
+        print_data(e.segment[s].bytes);
+        printf(": alpha %.4e us beta %.4e ns/B (%.4e GB/s)\n", e.segment[s].alpha * 1e6, e.segment[s].beta * 1e9, e.segment[s].beta > 0 ? 1e-9 / e.segment[s].beta : 0.0);
+      }
+      printf("\n");
+    }
+  }
+
+  // WRITTEN BY printid (COLLECTIVE SO THAT THE FILE CAN BE READ RIGHT AFTER)
+  bool write(const char *filename) {
+    int root = printid < 0 ? 0 : printid;
+    int success = 1;
+    if(myid == root)
+      success = write_file(filename);
+    broadcast(&success, &success, root);
+    return success;
+  }
+  bool write_file(const char *filename) {
+    FILE *file = fopen(filename, "w");
+    if(file == nullptr) {
+      printf("cannot open %s\n", filename);
+      return false;
+    }
+    fprintf(file, "# CommBench model: lib link L o g G numseg (bytes alpha beta)...\n");
+    for(entry_t &e : entry) {
+      fprintf(file, "%d %d %.6e %.6e %.6e %.6e %zu", e.lib, e.link, e.L, e.o, e.g, e.G, e.segment.size());
+      for(segment_t &s : e.segment)
+        fprintf(file, " %.6e %.6e %.6e", s.bytes, s.alpha, s.beta);
+      fprintf(file, " # %s %s\n", lib_name((library)e.lib), link_name(e.link));
+    }
+    fclose(file);
+    if(myid == printid)
+      printf("model is written to %s\n", filename);
+    return true;
+  }
+
+  bool read(const char *filename) {
+    FILE *file = fopen(filename, "r");
+    if(file == nullptr) {
+      if(myid == printid)
+        printf("cannot open %s\n", filename);
+      return false;
+    }
+    entry.clear();
+    char line[4096];
+    while(fgets(line, sizeof(line), file)) {
+      if(line[0] == '#')
+        continue;
+      entry_t e;
+      size_t numseg;
+      int n;
+      char *ptr = line;
+      if(sscanf(ptr, "%d %d %lf %lf %lf %lf %zu%n", &e.lib, &e.link, &e.L, &e.o, &e.g, &e.G, &numseg, &n) < 7)
+        continue;
+      ptr += n;
+      for(size_t s = 0; s < numseg; s++) {
+        segment_t seg;
+        if(sscanf(ptr, "%lf %lf %lf%n", &seg.bytes, &seg.alpha, &seg.beta, &n) < 3)
+          break;
+        ptr += n;
+        e.segment.push_back(seg);
+      }
+      if(e.segment.size())
+        entry.push_back(e);
+    }
+    fclose(file);
+    return true;
+  }
+};
@@ -0,0 +1,182 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// BINARY COMMUNICATION PATTERN
+// header: magic "CBPATTRN", uint64 numproc, uint64 nnz
+// rows (senders):    uint64 rowptr[numproc + 1], uint32 colind[nnz], uint64 count[nnz]
+// columns (recvers): uint64 colptr[numproc + 1], uint32 rowind[nnz], uint64 count[nnz]
+// counts are number of elements from sender (row) to receiver (column)
+
+struct pattern_header_t {
+  char magic[8];
+  uint64_t numproc;
+  uint64_t nnz;
+};
+
+struct pattern_t {
+
+  int numproc = 0;
+  std::vector<int> sendproc;
+  std::vector<size_t> sendcount;
+  std::vector<int> recvproc;
+  std::vector<size_t> recvcount;
+
+  size_t sendtotal() {
+    size_t total = 0;
+    for(size_t count : sendcount)
+      total += count;
+    return total;
+  }
+  size_t recvtotal() {
+    size_t total = 0;
+    for(size_t count : recvcount)
+      total += count;
+    return total;
+  }
+
+  // MAP THE FILE AND READ ONLY THE ROW AND COLUMN OF PROCESS id
+  bool load(const char *filename, int id) {
+    int fd = open(filename, O_RDONLY);
+    if(fd < 0) {
+      printf("cannot open pattern %s\n", filename);
+      return false;
+    }
+    struct stat st;
+    fstat(fd, &st);
+    size_t filesize = st.st_size;
+    void *base = mmap(nullptr, filesize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(base == MAP_FAILED) {
+      printf("cannot map pattern %s\n", filename);
+      return false;
+    }
+    const pattern_header_t *header = (const pattern_header_t*)base;
+    bool valid = (filesize >= sizeof(pattern_header_t)) && !memcmp(header->magic, "CBPATTRN", 8);
+    size_t part = 0;
+    if(valid) {
+      part = (header->numproc + 1) * sizeof(uint64_t) + header->nnz * (sizeof(uint32_t) + sizeof(uint64_t));
+      valid = (filesize == sizeof(pattern_header_t) + 2 * part) && (id >= 0) && ((uint64_t)id < header->numproc);
+    }
+    if(!valid) {
+      printf("invalid pattern %s for process %d\n", filename, id);
+      munmap(base, filesize);
+      return false;
+    }
+    numproc = header->numproc;
+    size_t nnz = header->nnz;
+    const char *ptr = (const char*)base + sizeof(pattern_header_t);
+    for(int dir = 0; dir < 2; dir++) {
+      const uint64_t *displ = (const uint64_t*)ptr;
+      const uint32_t *index = (const uint32_t*)(displ + numproc + 1);
+      const uint64_t *count = (const uint64_t*)(index + nnz);
+      std::vector<int> &proc = (dir == 0 ? sendproc : recvproc);
+      std::vector<size_t> &counts = (dir == 0 ? sendcount : recvcount);
+      proc.clear();
+      counts.clear();
+      for(uint64_t k = displ[id]; k < displ[id + 1]; k++) {
+        proc.push_back(index[k]);
+        counts.push_back(count[k]);
+      }
+      ptr += part;
+    }
+    munmap(base, filesize);
+    return true;
+  }
+};
+
+// WRITE A DENSE MATRIX (matrix[sender][recver]) INTO THE BINARY FORMAT
+static bool write_pattern(const char *filename, std::vector<std::vector<size_t>> &matrix) {
+  uint64_t numproc = matrix.size();
+  std::vector<uint64_t> rowptr(numproc + 1, 0);
+  std::vector<uint64_t> colptr(numproc + 1, 0);
+  for(uint64_t i = 0; i < numproc; i++)
+    for(uint64_t j = 0; j < numproc; j++)
+      if(matrix[i][j]) {
+        rowptr[i + 1]++;
+        colptr[j + 1]++;
+      }
+  for(uint64_t i = 0; i < numproc; i++) {
+    rowptr[i + 1] += rowptr[i];
+    colptr[i + 1] += colptr[i];
+  }
+  uint64_t nnz = rowptr[numproc];
+  std::vector<uint32_t> colind(nnz);
+  std::vector<uint32_t> rowind(nnz);
+  std::vector<uint64_t> rowval(nnz);
+  std::vector<uint64_t> colval(nnz);
+  std::vector<uint64_t> colnext(colptr.begin(), colptr.end() - 1);
+  for(uint64_t i = 0; i < numproc; i++) {
+    uint64_t k = rowptr[i];
+    for(uint64_t j = 0; j < numproc; j++)
+      if(matrix[i][j]) {
+        colind[k] = j;
+        rowval[k++] = matrix[i][j];
+        rowind[colnext[j]] = i;
+        colval[colnext[j]++] = matrix[i][j];
+      }
+  }
+  FILE *fp = fopen(filename, "wb");
+  if(!fp) {
+    printf("cannot open %s\n", filename);
+    return false;
+  }
+  pattern_header_t header = {{'C', 'B', 'P', 'A', 'T', 'T', 'R', 'N'}, numproc, nnz};
+  fwrite(&header, sizeof(header), 1, fp);
+  fwrite(rowptr.data(), sizeof(uint64_t), numproc + 1, fp);
+  fwrite(colind.data(), sizeof(uint32_t), nnz, fp);
+  fwrite(rowval.data(), sizeof(uint64_t), nnz, fp);
+  fwrite(colptr.data(), sizeof(uint64_t), numproc + 1, fp);
+  fwrite(rowind.data(), sizeof(uint32_t), nnz, fp);
+  fwrite(colval.data(), sizeof(uint64_t), nnz, fp);
+  fclose(fp);
+  return true;
+}
+
+// CONVERT AN N x N TEXT MATRIX (ONE SENDER PER LINE) INTO THE BINARY FORMAT
+bool convert_pattern(const char *textfile, const char *binfile) {
+  FILE *fp = fopen(textfile, "r");
+  if(!fp) {
+    printf("cannot open %s\n", textfile);
+    return false;
+  }
+  std::vector<std::vector<size_t>> matrix;
+  char *line = nullptr;
+  size_t length = 0;
+  while(getline(&line, &length, fp) != -1) {
+    std::vector<size_t> row;
+    char *ptr = line;
+    char *end;
+    for(size_t val = strtoull(ptr, &end, 10); end != ptr; val = strtoull(ptr, &end, 10)) {
+      row.push_back(val);
+      ptr = end;
+    }
+    if(row.empty())
+      continue;
+    if(matrix.size() && row.size() != matrix[0].size()) {
+      printf("%s row %zu has %zu entries, expected %zu\n", textfile, matrix.size(), row.size(), matrix[0].size());
+      ::free(line);
+      fclose(fp);
+      return false;
+    }
+    matrix.push_back(row);
+  }
+  ::free(line);
+  fclose(fp);
+  if(matrix.size() != (matrix.size() ? matrix[0].size() : 1)) {
+    printf("%s is not a square matrix\n", textfile);
+    return false;
+  }
+  return write_pattern(binfile, matrix);
+}
@@ -0,0 +1,202 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// RESULTS SINK
+// every measurement is recorded by all processes, each process writes one record with its own host and volume,
+// process 0 additionally writes the run metadata (time, MPI library, environment, and per-iteration times)
+// records are JSON lines, or CSV when the file name ends with .csv (metadata columns are empty on other processes)
+// the file stays open from results_init() to finalize(), all records of a measurement are written in parallel with MPI-IO
+// (with GASNet, each process appends to filename.<proc>)
+
+#ifndef COMMBENCH_GIT_HASH
+#define COMMBENCH_GIT_HASH "unknown" // e.g. -DCOMMBENCH_GIT_HASH=\"$(git rev-parse --short HEAD)\"
+#endif
+
+static const char *results_file = nullptr;
+static bool results_csv = false;
+static long results_offset = 0;
+static int results_id = 0;
+#ifdef USE_MPI
+static MPI_File results_handle = MPI_FILE_NULL;
+#else
+static FILE *results_handle = nullptr;
+#endif
+
+static void results_finalize() {
+#ifdef USE_MPI
+  if(results_handle != MPI_FILE_NULL)
+    MPI_File_close(&results_handle);
+#else
+  if(results_handle)
+    fclose(results_handle);
+  results_handle = nullptr;
+#endif
+  results_file = nullptr;
+}
+
+// COLLECTIVE, A PREVIOUS FILE IS CLOSED
+void results_init(const char *filename) {
+  results_finalize();
+  size_t length = strlen(filename);
+  results_csv = length >= 4 && !strcmp(filename + length - 4, ".csv");
+  results_offset = 0;
+  results_id = 0;
+#ifdef USE_MPI
+  if(MPI_File_open(comm_mpi, filename, MPI_MODE_CREATE | MPI_MODE_WRONLY, MPI_INFO_NULL, &results_handle) != MPI_SUCCESS) {
+    if(myid == printid)
+      printf("cannot open %s\n", filename);
+    results_handle = MPI_FILE_NULL;
+    return;
+  }
+  MPI_File_set_size(results_handle, 0);
+#else
+  results_handle = fopen((std::string(filename) + "." + std::to_string(myid)).c_str(), "w");
+  if(!results_handle)
+    printf("proc %d cannot open %s.%d\n", myid, filename, myid);
+  if(!allreduce_land(results_handle != nullptr)) {
+    results_finalize();
+    return;
+  }
+#endif
+  results_file = filename;
+}
+
+static void results_append(std::string &record, const char *format, ...) {
+  char buffer[1024];
+  va_list args;
+  va_start(args, format);
+  vsnprintf(buffer, sizeof(buffer), format, args);
+  va_end(args);
+  record += buffer;
+}
+// CSV FIELD, QUOTED WHEN NEEDED
+static std::string results_quote(const std::string &text) {
+  if(text.find_first_of(",\"\n") == std::string::npos)
+    return text;
+  std::string quoted = "\"";
+  for(char c : text)
+    quoted += (c == '"' ? std::string("\"\"") : std::string(1, c));
+  return quoted + "\"";
+}
+static std::string results_escape(const char *text) {
+  std::string escaped;
+  for(const char *c = text; *c; c++)
+    if(*c == '"' || *c == '\\')
+      escaped += std::string("\\") + *c;
+    else if(*c == '\n')
+      escaped += "\\n";
+    else if((unsigned char)*c >= 0x20)
+      escaped += *c;
+  return escaped;
+}
+
+// WRITE ONE RECORD PER PROCESS AT CONSECUTIVE OFFSETS (COLLECTIVE)
+static void results_write(std::string &record) {
+  long length = record.size();
+  std::vector<long> lengths(numproc);
+  allgather(&length, lengths.data());
+  long offset = results_offset;
+  for(int p = 0; p < myid; p++)
+    offset += lengths[p];
+#ifdef USE_MPI
+  MPI_File_write_at_all(results_handle, offset, record.data(), length, MPI_CHAR, MPI_STATUS_IGNORE);
+#else
+  fwrite(record.data(), 1, length, results_handle);
+  fflush(results_handle);
+#endif
+  for(int p = 0; p < numproc; p++)
+    results_offset += lengths[p];
+}
+
+// RECORD A MEASUREMENT (COLLECTIVE)
+// count and bytes are the totals of the pattern, sendbytes and recvbytes are of this process
+static void results_record(const char *mode, int bench, const char *lib, int numcomm, size_t count, size_t bytes, size_t sendbytes, size_t recvbytes, histogram_t &hist, const std::vector<double> &iters) {
+  if(!results_file)
+    return;
+  char host[64] = {0};
+  gethostname(host, sizeof(host) - 1);
+  double stats[7] = {hist.min, hist.percentile(0.5), hist.percentile(0.9), hist.percentile(0.99), hist.percentile(0.999), hist.max, hist.mean()};
+  // RUN METADATA
+  char date[32] = {0};
+  std::string mpi;
+  std::vector<std::pair<std::string, std::string>> env;
+  if(myid == 0) {
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+#ifdef USE_MPI
+    char version[MPI_MAX_LIBRARY_VERSION_STRING];
+    int length;
+    MPI_Get_library_version(version, &length);
+    mpi = version;
+#endif
+    const char *prefix[] = {"COMMBENCH_", "OMP_", "SLURM_", "PBS_", "MPICH_", "OMPI_MCA_", "UCX_", "NCCL_", "FI_", "CUDA_VISIBLE_DEVICES", "HIP_VISIBLE_DEVICES", "ZE_"};
+    for(char **var = ::environ; *var; var++)
+      for(const char *p : prefix)
+        if(!strncmp(*var, p, strlen(p))) {
+          std::string text(*var);
+          size_t eq = text.find('=');
+          env.push_back({text.substr(0, eq), text.substr(eq + 1)});
+          break;
+        }
+  }
+  std::string record;
+  if(results_csv) {
+    if(results_offset == 0 && myid == 0)
+      record += "id,mode,bench,lib,proc,host,numproc,numcomm,count,bytes,sendbytes,recvbytes,numiter,min,p50,p90,p99,p999,max,avg,git,date,timer,timer_resolution,timer_overhead,mpi,env,iters\n";
+    results_append(record, "%d,%s,%d,%s,%d,%s,%d,%d,%zu,%zu,%zu,%zu,%lu", results_id, mode, bench, lib, myid, results_quote(host).c_str(), numproc, numcomm, count, bytes, sendbytes, recvbytes, hist.count);
+    for(double stat : stats)
+      results_append(record, ",%.6e", stat);
+    results_append(record, ",%s", COMMBENCH_GIT_HASH);
+    if(myid == 0) {
+      // ENVIRONMENT AS NAME=VALUE AND ITERATIONS SEPARATED WITH SEMICOLONS
+      results_append(record, ",%s,%s,%.6e,%.6e,", date, timer_name(timer), timer_resolution, timer_overhead);
+      record += results_quote(mpi) + ",";
+      std::string vars;
+      for(size_t i = 0; i < env.size(); i++)
+        vars += (i ? ";" : "") + env[i].first + "=" + env[i].second;
+      record += results_quote(vars) + ",";
+      for(size_t i = 0; i < iters.size(); i++)
+        results_append(record, "%s%.6e", i ? ";" : "", iters[i]);
+      record += "\n";
+    }
+    else
+      record += ",,,,,,,\n";
+  }
+  else {
+    results_append(record, "{\"id\": %d, \"mode\": \"%s\", \"bench\": %d, \"lib\": \"%s\", \"proc\": %d, \"host\": \"%s\", ", results_id, mode, bench, lib, myid, results_escape(host).c_str());
+    results_append(record, "\"numproc\": %d, \"numcomm\": %d, \"count\": %zu, \"bytes\": %zu, \"sendbytes\": %zu, \"recvbytes\": %zu, \"numiter\": %lu, ", numproc, numcomm, count, bytes, sendbytes, recvbytes, hist.count);
+    const char *name[7] = {"min", "p50", "p90", "p99", "p999", "max", "avg"};
+    for(int i = 0; i < 7; i++)
+      results_append(record, "\"%s\": %.6e, ", name[i], stats[i]);
+    results_append(record, "\"git\": \"%s\"", COMMBENCH_GIT_HASH);
+    if(myid == 0) {
+      results_append(record, ", \"date\": \"%s\"", date);
+      results_append(record, ", \"timer\": \"%s\", \"timer_resolution\": %.6e, \"timer_overhead\": %.6e", timer_name(timer), timer_resolution, timer_overhead);
+#ifdef USE_MPI
+      record += ", \"mpi\": \"" + results_escape(mpi.c_str()) + "\"";
+#endif
+      record += ", \"env\": {";
+      for(size_t i = 0; i < env.size(); i++)
+        record += std::string(i ? ", " : "") + "\"" + results_escape(env[i].first.c_str()) + "\": \"" + results_escape(env[i].second.c_str()) + "\"";
+      record += "}, \"iters\": [";
+      for(size_t i = 0; i < iters.size(); i++)
+        results_append(record, "%s%.6e", i ? ", " : "", iters[i]);
+      record += "]";
+    }
+    record += "}\n";
+  }
+  results_write(record);
+  results_id++;
+}
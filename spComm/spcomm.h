@@ -170,6 +170,7 @@ namespace CommBench {
     }
 
     void start() {
+      trace("precompute", 'B', Comm<T>::benchid, -1);
       for (int i : precompid) {
 #if defined PORT_CUDA || defined PORT_HIP
         const int blocksize = 256;
@@ -189,6 +190,7 @@ namespace CommBench {
         queue_comp[i].wait();
 #endif
       }
+      trace("precompute", 'E', Comm<T>::benchid, -1);
       Comm<T>::start();
       for(int i = 0; i < count_self.size(); i++) {
 #ifdef PORT_CUDA
@@ -198,7 +200,7 @@ namespace CommBench {
 #elif defined PORT_SYCL
 	queue_self[i].memcpy(recvbuf_self[i], sendbuf_self[i], count_self[i] * sizeof(T));
 #else
-	memcpy(recvbuf_self[i], sendbuf_self[i], count_self[i] * sizeof(T));
+	copy_engine.copy(Comm<T>::copythread ? Comm<T>::copythread : copy_engine.maxthread(), recvbuf_self[i], sendbuf_self[i], count_self[i] * sizeof(T));
 #endif
       }
     }
@@ -214,6 +216,7 @@ namespace CommBench {
 #endif
       }
       Comm<T>::wait();
+      trace("postcompute", 'B', Comm<T>::benchid, -1);
       for (int i : postcompid) {
 #if defined PORT_CUDA || defined PORT_HIP
         const int blocksize = 256;
@@ -233,23 +236,17 @@ namespace CommBench {
         queue_comp[i].wait();
 #endif
       }
+      trace("postcompute", 'E', Comm<T>::benchid, -1);
     }
     void measure(int warmup, int numiter, size_t count) {
       Comm<T>::report();
-      double minTime;
-      double medTime;
-      double maxTime;
-      double avgTime;
-      CommBench::measure(warmup, numiter, minTime, medTime, maxTime, avgTime, *this);
-      if(myid == printid) {
-        size_t data = count * sizeof(T);
-        printf("data: "); print_data(data); printf("\n");
-        printf("minTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", minTime * 1e6, minTime / data * 1e12, data / minTime / 1e9);
-        printf("medTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", medTime * 1e6, medTime / data * 1e12, data / medTime / 1e9);
-        printf("maxTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", maxTime * 1e6, maxTime / data * 1e12, data / maxTime / 1e9);
-        printf("avgTime: %.4e us, %.4e ms/GB, %.4e GB/s\n", avgTime * 1e6, avgTime / data * 1e12, data / avgTime / 1e9);
-        printf("\n");
-      }
+      histogram_t hist;
+      std::vector<double> iters;
+      CommBench::measure(warmup, numiter, hist, *this, results_file ? &iters : nullptr);
+      hist.print(count * sizeof(T));
+      Comm<T>::record("measure", count, hist, iters);
+      if(coldcache)
+        Comm<T>::measure_cold(warmup, numiter, count, hist, *this);
     };
     void measure(int warmup, int numiter) {
       long count_total = 0;
@@ -258,5 +255,16 @@ namespace CommBench {
       MPI_Allreduce(MPI_IN_PLACE, &count_total, 1, MPI_LONG, MPI_SUM, comm_mpi);
       measure(warmup, numiter, count_total);
     };
+    void measure_adaptive(double precision, double budget) {
+      long count_total = 0;
+      for(int send = 0; send < Comm<T>::numsend; send++)
+         count_total += Comm<T>::sendcount[send];
+      MPI_Allreduce(MPI_IN_PLACE, &count_total, 1, MPI_LONG, MPI_SUM, comm_mpi);
+      Comm<T>::report();
+      histogram_t hist;
+      CommBench::measure_adaptive(precision, budget, hist, *this);
+      hist.print(count_total * sizeof(T));
+      Comm<T>::record("adaptive", count_total, hist, std::vector<double>());
+    };
   };
 }
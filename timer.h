@@ -0,0 +1,143 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TIMER
+// all measurements read the clock through wtime(), whose backend is selected with CommBench::timer before init() or with set_timer()
+// the resolution and the read overhead of the backend are measured at selection,
+// and the overhead (one read falls into every interval) is subtracted from sub-microsecond durations
+
+enum timer_backend {timer_omp, timer_monotonic, timer_tsc, timer_mpi};
+static timer_backend timer = timer_omp;
+static double timer_resolution = 0;
+static double timer_overhead = 0;
+static double tsc_period = 0; // seconds per tick, calibrated against CLOCK_MONOTONIC_RAW
+static uint64_t tsc_ref = 0;
+
+static const char* timer_name(timer_backend backend) {
+  switch(backend) {
+    case timer_omp       : return "omp_get_wtime";
+    case timer_monotonic : return "CLOCK_MONOTONIC_RAW";
+    case timer_tsc       : return "TSC";
+    case timer_mpi       : return "MPI_Wtime";
+  }
+  return "unknown";
+}
+
+static inline uint64_t read_tsc() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int aux;
+  return __rdtscp(&aux); // WAITS FOR THE PRECEDING INSTRUCTIONS
+#elif defined(__aarch64__)
+  uint64_t tick;
+  asm volatile("isb; mrs %0, cntvct_el0" : "=r"(tick));
+  return tick;
+#else
+  return 0;
+#endif
+}
+
+static inline double monotonic_time() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static inline double wtime() {
+  switch(timer) {
+    case timer_omp       : return omp_get_wtime();
+    case timer_monotonic : return monotonic_time();
+    case timer_tsc       : return (read_tsc() - tsc_ref) * tsc_period;
+#ifdef USE_MPI
+    case timer_mpi       : return MPI_Wtime();
+#else
+    case timer_mpi       : return omp_get_wtime();
+#endif
+  }
+  return omp_get_wtime();
+}
+
+// SUBTRACT THE READ OVERHEAD FROM SUB-MICROSECOND DURATIONS, NEVER BELOW THE RESOLUTION
+static inline double timer_correct(double time) {
+  if(time < 1e-6)
+    return std::max(time - timer_overhead, timer_resolution);
+  return time;
+}
+
+// THE COUNTER MUST TICK AT A CONSTANT RATE REGARDLESS OF FREQUENCY SCALING AND SLEEP STATES
+static bool tsc_invariant() {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned int eax, ebx, ecx, edx;
+  if(!__get_cpuid(0x80000007, &eax, &ebx, &ecx, &edx))
+    return false;
+  return edx & (1 << 8);
+#elif defined(__aarch64__)
+  return true; // THE GENERIC TIMER HAS A FIXED FREQUENCY
+#else
+  return false;
+#endif
+}
+
+static void tsc_calibrate() {
+  tsc_ref = read_tsc();
+  double time = monotonic_time();
+  while(monotonic_time() - time < 0.02);
+  uint64_t tick = read_tsc();
+  time = monotonic_time() - time;
+  tsc_period = time / (tick - tsc_ref);
+}
+
+static void clock_reset(); // CLOCK SYNCHRONIZATION IS MADE WITH THE PREVIOUS BACKEND
+
+// COLLECTIVE IF THE CLOCKS ARE SYNCHRONIZED
+static void set_timer(timer_backend backend) {
+  if(backend == timer_tsc && !tsc_invariant()) {
+    if(myid == printid)
+      printf("TSC is not invariant, falling back to %s\n", timer_name(timer_monotonic));
+    backend = timer_monotonic;
+  }
+#ifndef USE_MPI
+  if(backend == timer_mpi) {
+    if(myid == printid)
+      printf("MPI is not used, falling back to %s\n", timer_name(timer_omp));
+    backend = timer_omp;
+  }
+#endif
+  timer = backend;
+  if(timer == timer_tsc)
+    tsc_calibrate();
+  // RESOLUTION: SMALLEST NONZERO DIFFERENCE BETWEEN CONSECUTIVE READS
+  const int numread = 100000;
+  double resolution = HUGE_VAL;
+  double time = wtime();
+  for(int i = 0; i < numread; i++) {
+    double next = wtime();
+    if(next > time && next - time < resolution)
+      resolution = next - time;
+    time = next;
+  }
+  // OVERHEAD: AVERAGE TIME OF A READ
+  time = wtime();
+  for(int i = 0; i < numread; i++)
+    wtime();
+  timer_overhead = (wtime() - time) / (numread + 1);
+  timer_resolution = resolution;
+  if(myid == printid) {
+    printf("timer: %s resolution %.4e us overhead %.4e us", timer_name(timer), timer_resolution * 1e6, timer_overhead * 1e6);
+    if(timer == timer_tsc)
+      printf(" (%.4f GHz)", 1e-9 / tsc_period);
+    printf("\n");
+  }
+  clock_reset();
+}
@@ -0,0 +1,155 @@
+/* Copyright 2023 Stanford University
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// TIMELINE TRACING
+// events are recorded into a preallocated ring buffer (the oldest events are overwritten when it is full)
+// and all processes' events are dumped as a single Chrome trace JSON (chrome://tracing, ui.perfetto.dev) at finalize()
+// phases: 'B' begin, 'E' end, 'i' instant (message completion)
+
+struct trace_event_t {
+  const char *name; // must be a string literal
+  double time;
+  int bench;
+  int index;
+  char phase;
+};
+
+static bool tracing = false;
+static const char *trace_file = nullptr;
+static std::vector<trace_event_t> trace_buffer;
+static std::atomic<size_t> trace_head(0);
+
+void trace_init(const char *filename, size_t capacity) {
+  if(capacity == 0) {
+    if(myid == printid)
+      printf("trace capacity must be positive, tracing is not enabled\n");
+    return;
+  }
+  trace_buffer.resize(capacity);
+  trace_head = 0;
+  trace_file = filename;
+  tracing = true;
+}
+
+static inline void trace(const char *name, char phase, int bench, int index) {
+  if(!tracing)
+    return;
+  trace_event_t &event = trace_buffer[trace_head.fetch_add(1, std::memory_order_relaxed) % trace_buffer.size()];
+  event.time = wtime();
+  event.name = name;
+  event.bench = bench;
+  event.index = index;
+  event.phase = phase;
+}
+
+// GATHER AND WRITE THE TRACE (COLLECTIVE)
+static void trace_dump() {
+  if(!tracing || !trace_file)
+    return;
+  tracing = false;
+  // TIMESTAMPS ARE CONVERTED TO THE CLOCK OF PROCESS 0
+  if(!clock_synced)
+    sync_clocks();
+  struct record_t {
+    char name[24];
+    double time;
+    int proc;
+    int bench;
+    int index;
+    char phase;
+  };
+  size_t head = trace_head.load();
+  size_t numevent = std::min(head, trace_buffer.size());
+  // AN OVERWRITTEN RING CAN LEAVE END EVENTS WITHOUT THEIR BEGIN (AND AN INTERRUPTED RUN BEGIN EVENTS WITHOUT THEIR END):
+  // EACH END IS MATCHED WITH THE LAST OPEN BEGIN OF THE SAME NAME IN ITS LANE, ORPHANS ARE DROPPED
+  std::vector<bool> keep(numevent, true);
+  std::vector<std::pair<int, std::vector<size_t>>> open; // OPEN BEGIN EVENTS OF EACH LANE
+  for(size_t i = 0; i < numevent; i++) {
+    trace_event_t &event = trace_buffer[(head - numevent + i) % trace_buffer.size()];
+    if(event.phase != 'B' && event.phase != 'E')
+      continue;
+    size_t lane = 0;
+    while(lane < open.size() && open[lane].first != event.bench)
+      lane++;
+    if(lane == open.size())
+      open.push_back({event.bench, {}});
+    std::vector<size_t> &stack = open[lane].second;
+    if(event.phase == 'B')
+      stack.push_back(i);
+    else if(stack.size() && !strcmp(trace_buffer[(head - numevent + stack.back()) % trace_buffer.size()].name, event.name))
+      stack.pop_back();
+    else
+      keep[i] = false;
+  }
+  for(auto &lane : open)
+    for(size_t i : lane.second)
+      keep[i] = false;
+  std::vector<record_t> local;
+  for(size_t i = 0; i < numevent; i++) {
+    if(!keep[i])
+      continue;
+    trace_event_t &event = trace_buffer[(head - numevent + i) % trace_buffer.size()];
+    record_t record;
+    strncpy(record.name, event.name, sizeof(record.name) - 1);
+    record.name[sizeof(record.name) - 1] = 0;
+    record.time = global_time(event.time);
+    record.proc = myid;
+    record.bench = event.bench;
+    record.index = event.index;
+    record.phase = event.phase;
+    local.push_back(record);
+  }
+  if(head > trace_buffer.size())
+    printf("proc %d trace buffer overflow: %zu oldest events are dropped\n", myid, head - trace_buffer.size());
+  if(local.size() < numevent)
+    printf("proc %d trace: %zu unmatched begin / end events are dropped\n", myid, numevent - local.size());
+  std::vector<record_t> records;
+  int root = printid < 0 ? 0 : printid;
+  gather(local, records, root);
+  if(myid != root)
+    return;
+  FILE *fp = fopen(trace_file, "w");
+  if(!fp) {
+    printf("cannot open %s\n", trace_file);
+    return;
+  }
+  double origin = HUGE_VAL;
+  for(record_t &r : records)
+    origin = std::min(origin, r.time);
+  fprintf(fp, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  std::vector<std::pair<int, int>> lanes;
+  for(record_t &r : records)
+    if(std::find(lanes.begin(), lanes.end(), std::make_pair(r.proc, r.bench)) == lanes.end())
+      lanes.push_back(std::make_pair(r.proc, r.bench));
+  for(auto &lane : lanes)
+    if(lane.second < 0)
+      fprintf(fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"measure\"}},\n", lane.first, lane.second);
+    else
+      fprintf(fp, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": %d, \"tid\": %d, \"args\": {\"name\": \"bench %d\"}},\n", lane.first, lane.second, lane.second);
+  for(int p = 0; p < numproc; p++)
+    fprintf(fp, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": %d, \"args\": {\"name\": \"proc %d\"}}%s\n", p, p, p + 1 < numproc || records.size() ? "," : "");
+  for(size_t i = 0; i < records.size(); i++) {
+    record_t &r = records[i];
+    fprintf(fp, "{\"name\": \"%s\", \"ph\": \"%c\", \"ts\": %.3f, \"pid\": %d, \"tid\": %d", r.name, r.phase, (r.time - origin) * 1e6, r.proc, r.bench);
+    if(r.phase == 'i')
+      fprintf(fp, ", \"s\": \"t\"");
+    if(r.index >= 0)
+      fprintf(fp, ", \"args\": {\"index\": %d}", r.index);
+    fprintf(fp, "}%s\n", i + 1 < records.size() ? "," : "");
+  }
+  fprintf(fp, "]}\n");
+  fclose(fp);
+  printf("trace of %zu events is written to %s\n", records.size(), trace_file);
+}